@@ -0,0 +1,50 @@
+/*******************************************************************************
+**          File: async.hpp
+**        Author: neevek <i@neevek.net>.
+** Creation Time: 2026-10-17 Sat 02:31 PM
+**   Description: wraps uv_async_t
+*******************************************************************************/
+#ifndef UVCPP_ASYNC_H_
+#define UVCPP_ASYNC_H_
+#include "handle.hpp"
+
+namespace uvcpp {
+  struct EvAsync : public Event { };
+
+  class Async : public Handle<uv_async_t, Async> {
+    friend class Resource;
+    friend class Handle;
+
+    protected:
+      Async(const std::shared_ptr<Loop> &loop) : Handle(loop) { }
+
+      virtual bool init() override {
+        if (uv_async_init(
+              this->getLoop()->getRaw(), get(), onAsyncCallback) != 0) {
+          LOG_E("uv_async_init failed");
+          return false;
+        }
+        return true;
+      }
+
+    public:
+      /**
+       * thread-safe, wakes up the loop and publishes EvAsync on the loop
+       * thread, multiple calls made before the loop wakes up are coalesced
+       * into one EvAsync
+       */
+      bool send() {
+        // errors are not published, because this may run on another thread
+        return uv_async_send(
+          reinterpret_cast<uv_async_t *>(this->get())) == 0;
+      }
+
+    private:
+      static void onAsyncCallback(uv_async_t *a) {
+        reinterpret_cast<Async *>(a->data)->template
+          publish<EvAsync>(EvAsync{});
+      }
+  };
+} /* end of namspace: uvcpp */
+
+#endif /* end of include guard: UVCPP_ASYNC_H_ */
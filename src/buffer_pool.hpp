@@ -0,0 +1,210 @@
+/*******************************************************************************
+**          File: buffer_pool.hpp
+**        Author: neevek <i@neevek.net>.
+** Creation Time: 2026-10-18 Sun 09:40 AM
+**   Description: size classed pool of nul::Buffer
+*******************************************************************************/
+#ifndef UVCPP_BUFFER_POOL_H_
+#define UVCPP_BUFFER_POOL_H_
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include "nul/buffer.hpp"
+
+namespace uvcpp {
+
+  /**
+   * free lists of buffers with power of two capacities, from 64 bytes
+   * to 64 KB. not thread-safe, every Loop owns one (Loop::getBufferPool),
+   * and Stream/Udp return the buffers recycled through EvBufferRecycled
+   * to it automatically, unless a listener takes the buffer
+   */
+  class BufferPool final {
+    static const std::size_t kMinClassShift = 6;
+    static const std::size_t kMaxClassShift = 16;
+    static const std::size_t kClassCount = kMaxClassShift - kMinClassShift + 1;
+
+    public:
+      struct Stats {
+        // acquire() served from a free list
+        uint64_t hits{0};
+        // acquire() that had to allocate
+        uint64_t misses{0};
+        // buffers taken back into the free lists
+        uint64_t returns{0};
+        // buffers released but freed, not of a class size or list full
+        uint64_t drops{0};
+        // buffers handed out by acquire() and not released yet (sizes
+        // beyond the largest class excluded), and the peak of it
+        std::size_t inUse{0};
+        std::size_t highWater{0};
+        // buffers sitting in the free lists
+        std::size_t cached{0};
+      };
+
+      static constexpr std::size_t kMinClassSize = 1 << kMinClassShift;
+      static constexpr std::size_t kMaxClassSize = 1 << kMaxClassShift;
+
+      /**
+       * returns a buffer with capacity of the smallest class that fits
+       * size, sizes beyond the largest class are allocated as is
+       */
+      std::unique_ptr<nul::Buffer> acquire(std::size_t size) {
+        auto index = classIndex(size);
+        if (index >= kClassCount) {
+          ++stats_.misses;
+          return std::make_unique<nul::Buffer>(size);
+        }
+
+        std::unique_ptr<nul::Buffer> buffer;
+        auto &freeList = freeLists_[index];
+        if (freeList.empty()) {
+          ++stats_.misses;
+          buffer = std::make_unique<nul::Buffer>(kMinClassSize << index);
+        } else {
+          ++stats_.hits;
+          --stats_.cached;
+          buffer = std::move(freeList.back());
+          freeList.pop_back();
+        }
+
+        track(buffer.get());
+        if (++stats_.inUse > stats_.highWater) {
+          stats_.highWater = stats_.inUse;
+        }
+        return buffer;
+      }
+
+      /**
+       * takes the buffer back if its capacity is exactly a class size,
+       * otherwise (or if the free list is full) the buffer is freed
+       */
+      void release(std::unique_ptr<nul::Buffer> &&buffer) {
+        if (!buffer) {
+          return;
+        }
+        // buffers allocated elsewhere may be taken, but were never in use
+        if (untrack(buffer.get())) {
+          --stats_.inUse;
+        }
+
+        auto capacity = buffer->getCapacity();
+        auto index = classIndex(capacity);
+        if (index >= kClassCount || (kMinClassSize << index) != capacity) {
+          ++stats_.drops;
+          buffer.reset();
+          return;
+        }
+
+        auto &freeList = freeLists_[index];
+        if (freeList.size() >= maxCachedPerClass_) {
+          ++stats_.drops;
+          buffer.reset();
+          return;
+        }
+
+        ++stats_.returns;
+        ++stats_.cached;
+        buffer->setLength(0);
+        freeList.push_back(std::move(buffer));
+      }
+
+      /**
+       * 0 disables caching
+       */
+      void setMaxCachedPerClass(std::size_t maxCached) {
+        maxCachedPerClass_ = maxCached;
+        for (auto &freeList : freeLists_) {
+          if (freeList.size() > maxCached) {
+            stats_.cached -= freeList.size() - maxCached;
+            freeList.resize(maxCached);
+          }
+        }
+      }
+
+      const Stats &getStats() const {
+        return stats_;
+      }
+
+    private:
+      static std::size_t classIndex(std::size_t size) {
+        std::size_t index = 0;
+        while ((kMinClassSize << index) < size && index < kClassCount) {
+          ++index;
+        }
+        return index;
+      }
+
+      static std::size_t slotOf(const nul::Buffer *buffer, std::size_t mask) {
+        auto h = reinterpret_cast<uintptr_t>(buffer) >> 4;
+        h ^= h >> 16;
+        return (h * 0x9e3779b9u) & mask;
+      }
+
+      /**
+       * outstanding_ is an open addressing table kept at most half full,
+       * it only grows with the peak of inUse, so in steady state handing
+       * buffers out and taking them back doesn't allocate
+       */
+      void track(const nul::Buffer *buffer) {
+        if ((stats_.inUse + 1) * 2 > outstanding_.size()) {
+          std::vector<const nul::Buffer *> old(
+            std::max<std::size_t>(outstanding_.size() * 2, 64), nullptr);
+          old.swap(outstanding_);
+          for (auto b : old) {
+            if (b) {
+              insert(b);
+            }
+          }
+        }
+        insert(buffer);
+      }
+
+      void insert(const nul::Buffer *buffer) {
+        auto mask = outstanding_.size() - 1;
+        auto i = slotOf(buffer, mask);
+        while (outstanding_[i]) {
+          i = (i + 1) & mask;
+        }
+        outstanding_[i] = buffer;
+      }
+
+      bool untrack(const nul::Buffer *buffer) {
+        if (outstanding_.empty()) {
+          return false;
+        }
+
+        auto mask = outstanding_.size() - 1;
+        auto i = slotOf(buffer, mask);
+        while (outstanding_[i] != buffer) {
+          if (!outstanding_[i]) {
+            return false;
+          }
+          i = (i + 1) & mask;
+        }
+
+        // shifts back the entries of the probe run that follows, so no
+        // lookup stops early at the hole
+        for (auto j = (i + 1) & mask; outstanding_[j]; j = (j + 1) & mask) {
+          auto home = slotOf(outstanding_[j], mask);
+          if (((j - home) & mask) >= ((j - i) & mask)) {
+            outstanding_[i] = outstanding_[j];
+            i = j;
+          }
+        }
+        outstanding_[i] = nullptr;
+        return true;
+      }
+
+    private:
+      std::vector<std::unique_ptr<nul::Buffer>> freeLists_[kClassCount];
+      // the buffers counted in inUse
+      std::vector<const nul::Buffer *> outstanding_;
+      std::size_t maxCachedPerClass_{1024};
+      Stats stats_;
+  };
+
+} /* end of namspace: uvcpp */
+
+#endif /* end of include guard: UVCPP_BUFFER_POOL_H_ */
@@ -0,0 +1,641 @@
+/*******************************************************************************
+**          File: coro.hpp
+**        Author: neevek <i@neevek.net>.
+** Creation Time: 2026-10-25 Sun 10:15 AM
+**   Description: optional C++20 coroutine layer, not included by uvcpp.h
+*******************************************************************************/
+#ifndef UVCPP_CORO_H_
+#define UVCPP_CORO_H_
+#if __cplusplus < 202002L || !defined(__cpp_impl_coroutine)
+#error "coro.hpp needs C++20 coroutines, compile with -std=c++20"
+#endif
+#include "stream.hpp"
+#include "req.hpp"
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace uvcpp {
+
+  /**
+   * free lists of coroutine frames with power of two sizes, from 64 bytes
+   * to 4 KB. a Loop runs on one thread, so the pool of the thread serves
+   * the frames of the coroutines of its loops, and a coroutine that ran
+   * before allocates its next frame without touching the heap
+   */
+  class CoFramePool final {
+    static const std::size_t kMinClassShift = 6;
+    static const std::size_t kMaxClassShift = 12;
+    static const std::size_t kClassCount = kMaxClassShift - kMinClassShift + 1;
+    static const std::size_t kMinClassSize = 1 << kMinClassShift;
+    static const std::size_t kMaxCachedPerClass = 1024;
+    // keeps the frame aligned as operator new would
+    static const std::size_t kHeaderSize = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+    struct FreeBlock {
+      FreeBlock *next;
+    };
+
+    public:
+      struct Stats {
+        // allocations served from a free list
+        uint64_t hits{0};
+        // allocations that went to the heap
+        uint64_t misses{0};
+        // frames sitting in the free lists
+        std::size_t cached{0};
+      };
+
+      static CoFramePool &current() {
+        static thread_local CoFramePool pool;
+        return pool;
+      }
+
+      ~CoFramePool() {
+        for (auto &head : freeLists_) {
+          while (head) {
+            auto next = head->next;
+            ::operator delete(head);
+            head = next;
+          }
+        }
+      }
+
+      void *allocate(std::size_t size) {
+        auto index = classIndex(size + kHeaderSize);
+        char *block;
+        if (index < kClassCount && freeLists_[index]) {
+          ++stats_.hits;
+          --stats_.cached;
+          auto head = freeLists_[index];
+          freeLists_[index] = head->next;
+          --counts_[index];
+          block = reinterpret_cast<char *>(head);
+        } else {
+          ++stats_.misses;
+          block = static_cast<char *>(::operator new(
+            index < kClassCount ? kMinClassSize << index : size + kHeaderSize));
+        }
+        *reinterpret_cast<std::size_t *>(block) = index;
+        return block + kHeaderSize;
+      }
+
+      void deallocate(void *p) {
+        auto block = static_cast<char *>(p) - kHeaderSize;
+        auto index = *reinterpret_cast<std::size_t *>(block);
+        if (index >= kClassCount || counts_[index] >= kMaxCachedPerClass) {
+          ::operator delete(block);
+          return;
+        }
+
+        auto head = reinterpret_cast<FreeBlock *>(block);
+        head->next = freeLists_[index];
+        freeLists_[index] = head;
+        ++counts_[index];
+        ++stats_.cached;
+      }
+
+      const Stats &getStats() const {
+        return stats_;
+      }
+
+    private:
+      static std::size_t classIndex(std::size_t size) {
+        std::size_t index = 0;
+        while ((kMinClassSize << index) < size && index < kClassCount) {
+          ++index;
+        }
+        return index;
+      }
+
+    private:
+      FreeBlock *freeLists_[kClassCount]{};
+      std::size_t counts_[kClassCount]{};
+      Stats stats_;
+  };
+
+  /**
+   * the result of a coroutine or of a job, T may be void
+   */
+  template <typename T>
+  struct CoValue {
+    template <typename U>
+    void set(U &&v) {
+      value.emplace(std::forward<U>(v));
+    }
+    T take() {
+      return std::move(*value);
+    }
+    std::optional<T> value;
+  };
+
+  template <>
+  struct CoValue<void> {
+    void take() { }
+  };
+
+  /**
+   * coroutine returning T. it starts suspended, and runs when it is
+   * co_await-ed by another coroutine, or detached with start(). frames come
+   * from CoFramePool
+   */
+  template <typename T = void>
+  class CoTask {
+    public:
+      struct promise_type;
+      using Handle = std::coroutine_handle<promise_type>;
+
+    private:
+      struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+
+        std::coroutine_handle<> await_suspend(Handle h) noexcept {
+          auto &p = h.promise();
+          if (p.continuation) {
+            return p.continuation;
+          }
+          if (p.detached) {
+            h.destroy();
+          }
+          return std::noop_coroutine();
+        }
+
+        void await_resume() noexcept { }
+      };
+
+      struct PromiseBase {
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        FinalAwaiter final_suspend() noexcept { return {}; }
+
+        void unhandled_exception() {
+          if (detached) {
+            std::terminate();
+          }
+          exception = std::current_exception();
+        }
+
+        static void *operator new(std::size_t size) {
+          return CoFramePool::current().allocate(size);
+        }
+
+        static void operator delete(void *p) {
+          CoFramePool::current().deallocate(p);
+        }
+
+        std::coroutine_handle<> continuation;
+        std::exception_ptr exception;
+        bool detached{false};
+      };
+
+      struct ValuePromise : public PromiseBase {
+        template <typename U>
+        void return_value(U &&v) {
+          result.set(std::forward<U>(v));
+        }
+        CoValue<T> result;
+      };
+
+      struct VoidPromise : public PromiseBase {
+        void return_void() { }
+        CoValue<void> result;
+      };
+
+    public:
+      struct promise_type : public std::conditional_t<
+          std::is_void<T>::value, VoidPromise, ValuePromise> {
+        CoTask get_return_object() {
+          return CoTask{ Handle::from_promise(*this) };
+        }
+      };
+
+      CoTask(CoTask &&other) noexcept : handle_(other.handle_) {
+        other.handle_ = nullptr;
+      }
+
+      CoTask &operator=(CoTask &&other) noexcept {
+        if (this != &other) {
+          if (handle_) {
+            handle_.destroy();
+          }
+          handle_ = other.handle_;
+          other.handle_ = nullptr;
+        }
+        return *this;
+      }
+
+      ~CoTask() {
+        if (handle_) {
+          handle_.destroy();
+        }
+      }
+
+      /**
+       * runs the coroutine until it first suspends, it then goes on by
+       * itself and frees its frame when it finishes, an exception escaping
+       * it terminates the program
+       */
+      void start() {
+        auto h = handle_;
+        handle_ = nullptr;
+        h.promise().detached = true;
+        h.resume();
+      }
+
+      auto operator co_await() && noexcept {
+        struct Awaiter {
+          bool await_ready() noexcept { return false; }
+
+          std::coroutine_handle<> await_suspend(
+              std::coroutine_handle<> continuation) noexcept {
+            h.promise().continuation = continuation;
+            return h;
+          }
+
+          T await_resume() {
+            auto &p = h.promise();
+            if (p.exception) {
+              std::rethrow_exception(p.exception);
+            }
+            return p.result.take();
+          }
+
+          Handle h;
+        };
+        return Awaiter{ handle_ };
+      }
+
+    private:
+      explicit CoTask(Handle h) : handle_(h) { }
+
+    private:
+      Handle handle_;
+  };
+
+  struct CoRead {
+    // valid until the coroutine suspends again
+    const char *buf;
+    // bytes read, or UV_EOF or an error code if negative
+    ssize_t nread;
+  };
+
+  /**
+   * co_await-able connect/read/write of a Tcp or Pipe. the listeners are
+   * registered once when the CoStream is created, awaiting allocates
+   * nothing. one coroutine may read while another writes, and the stream
+   * must not be read from or written to by other code meanwhile.
+   *
+   * read() resumes the reader right from EvRead with the data read, data
+   * that arrives while no coroutine reads is kept (copied) and reading is
+   * paused until the next read().
+   *
+   * coroutines may finish in the callbacks of the stream, so the stream is
+   * kept alive until it is closed, close it when done with it
+   */
+  template <typename S>
+  class CoStream {
+    struct State {
+      std::coroutine_handle<> reader;
+      std::coroutine_handle<> writer;
+      std::coroutine_handle<> connector;
+      CoRead readResult{ nullptr, 0 };
+      int writeResult{0};
+      int connectResult{0};
+      // data read while no reader waited, and the data handed out of it
+      std::string pending;
+      std::string delivered;
+      // UV_EOF or the error all later reads return
+      int readStatus{0};
+      bool reading{false};
+      bool closed{false};
+    };
+
+    public:
+      explicit CoStream(const std::shared_ptr<S> &stream) :
+        stream_(stream), state_(std::make_shared<State>()) {
+        stream->template selfRefUntil<EvClose>();
+        auto st = state_;
+        stream->template on<EvRead>([st](const auto &e, auto &stream) {
+          if (st->reader) {
+            st->readResult = CoRead{ e.buf, e.nread };
+            resume(st->reader);
+          } else {
+            st->pending.append(e.buf, e.nread);
+            st->reading = false;
+            stream.readStop();
+          }
+        });
+        stream->template on<EvEnd>([st](const auto &e, auto &stream) {
+          // only the reading side is done, writes are still in flight
+          st->reading = false;
+          if (!st->readStatus) {
+            st->readStatus = UV_EOF;
+          }
+          st->readResult = CoRead{ nullptr, st->readStatus };
+          resume(st->reader);
+        });
+        stream->template on<EvWrite>([st](const auto &e, auto &stream) {
+          st->writeResult = 0;
+          resume(st->writer);
+        });
+        stream->template on<EvConnect>([st](const auto &e, auto &stream) {
+          st->connectResult = 0;
+          resume(st->connector);
+        });
+        stream->template on<EvError>([st](const auto &e, auto &stream) {
+          fail(*st, e.status, e.status);
+        });
+        stream->template once<EvClose>([st](const auto &e, auto &stream) {
+          st->closed = true;
+          fail(*st, UV_EOF, UV_ECANCELED);
+        });
+      }
+
+      const std::shared_ptr<S> &get() const {
+        return stream_;
+      }
+
+      /**
+       * resumes with 0, or the error code of the failed connect, args are
+       * those of S::connect
+       */
+      template <typename ...Args>
+      auto connect(Args &&...args) {
+        struct Awaiter {
+          bool await_ready() {
+            if (st->closed) {
+              st->connectResult = UV_ECANCELED;
+              return true;
+            }
+            return false;
+          }
+
+          bool await_suspend(std::coroutine_handle<> h) {
+            auto state = st;
+            state->connector = h;
+            auto ok = std::apply([s = stream](auto &...a) {
+              return CoStream::doConnect(*s, a...);
+            }, args);
+            if (!ok && state->connector) {
+              state->connector = nullptr;
+              state->connectResult = UV_EINVAL;
+              return false;
+            }
+            // suspended, or already resumed by EvError
+            return true;
+          }
+
+          int await_resume() {
+            return st->connectResult;
+          }
+
+          State *st;
+          S *stream;
+          std::tuple<std::decay_t<Args>...> args;
+        };
+        return Awaiter{
+          state_.get(), stream_.get(),
+          std::tuple<std::decay_t<Args>...>{ std::forward<Args>(args)... } };
+      }
+
+      /**
+       * resumes with the data read, see CoRead
+       */
+      auto read() {
+        struct Awaiter {
+          bool await_ready() {
+            if (!st->pending.empty()) {
+              st->delivered.swap(st->pending);
+              st->pending.clear();
+              st->readResult = CoRead{
+                st->delivered.data(),
+                static_cast<ssize_t>(st->delivered.size()) };
+              return true;
+            }
+            if (st->readStatus) {
+              st->readResult = CoRead{ nullptr, st->readStatus };
+              return true;
+            }
+            return false;
+          }
+
+          void await_suspend(std::coroutine_handle<> h) {
+            auto state = st;
+            state->reader = h;
+            if (!state->reading) {
+              state->reading = true;
+              // a failure is published as EvError, which resumes the reader
+              stream->readStart();
+            }
+          }
+
+          CoRead await_resume() {
+            return st->readResult;
+          }
+
+          State *st;
+          S *stream;
+        };
+        return Awaiter{ state_.get(), stream_.get() };
+      }
+
+      /**
+       * resumes with 0 once the buffer is written, or an error code
+       */
+      auto write(std::unique_ptr<nul::Buffer> &&buffer) {
+        struct Awaiter {
+          bool await_ready() {
+            if (st->closed) {
+              st->writeResult = UV_ECANCELED;
+              return true;
+            }
+            return false;
+          }
+
+          bool await_suspend(std::coroutine_handle<> h) {
+            auto state = st;
+            state->writer = h;
+            if (!stream->writeAsync(std::move(buffer)) && state->writer) {
+              state->writer = nullptr;
+              state->writeResult = UV_ECANCELED;
+              return false;
+            }
+            return true;
+          }
+
+          int await_resume() {
+            return st->writeResult;
+          }
+
+          State *st;
+          S *stream;
+          std::unique_ptr<nul::Buffer> buffer;
+        };
+        return Awaiter{ state_.get(), stream_.get(), std::move(buffer) };
+      }
+
+    private:
+      template <typename T, typename ...Args>
+      static bool doConnect(T &stream, Args &...args) {
+        if constexpr (std::is_void<decltype(stream.connect(args...))>::value) {
+          stream.connect(args...);
+          return true;
+        } else {
+          return stream.connect(args...);
+        }
+      }
+
+      static void resume(std::coroutine_handle<> &waiter) {
+        if (waiter) {
+          auto h = waiter;
+          waiter = nullptr;
+          h.resume();
+        }
+      }
+
+      /**
+       * resumes all the waiters, reads fail with readStatus from now on
+       */
+      static void fail(State &st, int readStatus, int status) {
+        if (!st.readStatus) {
+          st.readStatus = readStatus;
+        }
+        st.readResult = CoRead{ nullptr, st.readStatus };
+        st.writeResult = status;
+        st.connectResult = status;
+        // the resumed coroutines may drop the last CoStream, the listeners
+        // keep the state
+        resume(st.reader);
+        resume(st.writer);
+        resume(st.connector);
+      }
+
+    private:
+      std::shared_ptr<S> stream_;
+      std::shared_ptr<State> state_;
+  };
+
+  struct CoDNSResult {
+    // 0, or the error code of the failed lookup
+    int status;
+    std::vector<std::string> addrs;
+  };
+
+  /**
+   * resolves addr with DNSRequest
+   */
+  inline auto coResolve(const std::shared_ptr<Loop> &loop,
+                        const std::string &addr, bool ipv4Only = false) {
+    struct Awaiter {
+      bool await_ready() { return false; }
+
+      bool await_suspend(std::coroutine_handle<> h) {
+        req = DNSRequest::create(loop);
+        req->on<EvDNSResult>([this](const auto &e, auto &req) {
+          result.addrs = e.dnsResults;
+        });
+        req->on<EvError>([this](const auto &e, auto &req) {
+          result.status = e.status;
+        });
+        req->once<EvDNSRequestFinish>([this](const auto &e, auto &req) {
+          finished = true;
+          if (waiter) {
+            auto w = waiter;
+            waiter = nullptr;
+            w.resume();
+          }
+        });
+        // alive until the callbacks are done, whatever the coroutine does
+        req->selfRefUntil<EvDNSRequestFinish>();
+        req->resolve(addr, ipv4Only);
+        if (finished) {
+          return false;
+        }
+        waiter = h;
+        return true;
+      }
+
+      CoDNSResult await_resume() {
+        return std::move(result);
+      }
+
+      std::shared_ptr<Loop> loop;
+      std::string addr;
+      bool ipv4Only;
+      std::shared_ptr<DNSRequest> req;
+      CoDNSResult result{ 0, {} };
+      std::coroutine_handle<> waiter;
+      bool finished{false};
+    };
+    return Awaiter{ loop, addr, ipv4Only };
+  }
+
+  /**
+   * runs fn on the libuv threadpool and resumes with what it returns,
+   * an exception thrown by fn is rethrown in the coroutine
+   */
+  template <typename F>
+  auto coWork(const std::shared_ptr<Loop> &loop, F &&fn) {
+    using Fn = std::decay_t<F>;
+    using R = std::invoke_result_t<Fn &>;
+
+    struct Awaiter {
+      bool await_ready() { return false; }
+
+      bool await_suspend(std::coroutine_handle<> h) {
+        work = Work::create(loop);
+        work->on<EvWork>([this](const auto &e, auto &work) {
+          try {
+            if constexpr (std::is_void<R>::value) {
+              fn();
+            } else {
+              result.set(fn());
+            }
+          } catch (...) {
+            exception = std::current_exception();
+          }
+        });
+        work->on<EvError>([this](const auto &e, auto &work) {
+          status = e.status;
+        });
+        work->once<EvAfterWork>([this](const auto &e, auto &work) {
+          auto w = waiter;
+          waiter = nullptr;
+          w.resume();
+        });
+        work->start();
+        if (status) {
+          return false;
+        }
+        work->selfRefUntil<EvAfterWork>();
+        waiter = h;
+        return true;
+      }
+
+      R await_resume() {
+        if (status) {
+          throw std::runtime_error(uv_strerror(status));
+        }
+        if (exception) {
+          std::rethrow_exception(exception);
+        }
+        return result.take();
+      }
+
+      std::shared_ptr<Loop> loop;
+      Fn fn;
+      std::shared_ptr<Work> work;
+      CoValue<R> result;
+      std::exception_ptr exception;
+      int status{0};
+      std::coroutine_handle<> waiter;
+    };
+    return Awaiter{ loop, std::forward<F>(fn) };
+  }
+} /* end of namspace: uvcpp */
+
+#endif /* end of include guard: UVCPP_CORO_H_ */
@@ -15,7 +15,9 @@ namespace uvcpp {
   struct EvBufferRecycled : public Event {
     EvBufferRecycled(std::unique_ptr<nul::Buffer> &&buffer) :
       buffer(std::forward<std::unique_ptr<nul::Buffer>>(buffer)) { }
-    std::unique_ptr<nul::Buffer> buffer;
+    // listeners may std::move() the buffer to keep it, otherwise it goes
+    // back to the BufferPool of the loop
+    mutable std::unique_ptr<nul::Buffer> buffer;
   };
 
   template <typename T, typename Derived>
@@ -31,6 +33,14 @@ namespace uvcpp {
       }
 
     public:
+      virtual ~Handle() {
+        auto handle = reinterpret_cast<uv_handle_t *>(this->get());
+        if (uv_handle_get_type(handle) != UV_UNKNOWN_HANDLE && !closed_) {
+          // still linked into the loop, which must not run its callbacks
+          ++this->getLoop()->abandonedHandles_;
+        }
+      }
+
       template <typename U = Derived, typename ...Args>
       static auto create(const std::shared_ptr<Loop> &loop, Args &&...args) {
         auto handle = Resource<T, U>::template
@@ -53,20 +63,40 @@ namespace uvcpp {
         return uv_is_closing(reinterpret_cast<uv_handle_t *>(this->get())) == 0;
       }
 
-      template<typename E>
-      void on(EventCallback<E, Derived> &&callback) {
+      template<typename E, typename F>
+      void on(F &&callback) {
         static_assert(!std::is_same<E, EvClose>::value,
                       "EvClose is not allowed to be registered with 'on'");
 
-        Resource<T, Derived>::template on<E>(
-          std::forward<EventCallback<E, Derived>>(callback));
+        Resource<T, Derived>::template on<E>(std::forward<F>(callback));
+      }
+
+    protected:
+      /**
+       * same Loop as getLoop(), without copying the shared_ptr
+       */
+      Loop *getRawLoop() {
+        return Loop::fromRaw(
+          reinterpret_cast<uv_handle_t *>(this->get())->loop);
+      }
+
+      void recycleBuffer(std::unique_ptr<nul::Buffer> &&buffer) {
+        EvBufferRecycled event{ std::move(buffer) };
+        this->template publish<EvBufferRecycled>(std::move(event));
+        if (event.buffer) {
+          getRawLoop()->getBufferPool().release(std::move(event.buffer));
+        }
       }
 
     private:
       static void closeCallback(uv_handle_t *h) {
-        reinterpret_cast<Handle *>(h->data)->template
-          publish<EvClose>(EvClose{});
+        auto handle = reinterpret_cast<Handle *>(h->data);
+        handle->closed_ = true;
+        handle->template publish<EvClose>(EvClose{});
       }
+
+    private:
+      bool closed_{false};
   };
 
 } /* end of namspace: uvcpp */
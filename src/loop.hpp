@@ -7,19 +7,95 @@
 #ifndef UVCPP_LOOP_H_
 #define UVCPP_LOOP_H_
 #include "uv.h"
+#include "mpsc_queue.hpp"
+#include "buffer_pool.hpp"
+#include "timer_wheel.hpp"
 #include <memory> 
 #include <functional>
 
 namespace uvcpp {
 
+  template <typename T, typename Derived> class Handle;
+
   class Loop final {
+    template <typename T, typename Derived> friend class Handle;
+
     public:
+      using Task = std::function<void()>;
+
+      /**
+       * work deferred to the end of the current loop iteration, it runs
+       * right after the I/O callbacks of this iteration (check phase), or
+       * before the loop blocks for I/O (prepare phase) if it is deferred
+       * from timer or close callbacks, it unschedules itself when destroyed
+       */
+      class Deferred {
+        friend class Loop;
+
+        public:
+          virtual ~Deferred() {
+            if (loop_) {
+              loop_->cancelDeferred(this);
+            }
+          }
+
+          bool isScheduled() const {
+            return loop_ != nullptr;
+          }
+
+        protected:
+          virtual void onDeferred() = 0;
+
+        private:
+          Loop *loop_{nullptr};
+          Deferred *prev_{nullptr};
+          Deferred *next_{nullptr};
+      };
+
       virtual ~Loop() {
+        if (initialized_) {
+          while (deferredHead_) {
+            cancelDeferred(deferredHead_);
+          }
+          timerWheel_.reset();
+
+          // internal handles must be closed, or uv_loop_close fails with EBUSY
+          uv_close(reinterpret_cast<uv_handle_t *>(&postAsync_), nullptr);
+          uv_close(reinterpret_cast<uv_handle_t *>(&deferredPrepare_), nullptr);
+          uv_close(reinterpret_cast<uv_handle_t *>(&deferredCheck_), nullptr);
+
+          // the close callbacks only run from uv_run, which would also run
+          // the callbacks of user handles and requests still pending, whose
+          // objects may be gone already, so the loop is only run when its
+          // own handles are all that is left, or they are leaked
+          if (onlyOwnHandlesLeft()) {
+            uv_run(&loop_, UV_RUN_NOWAIT);
+          }
+        }
         uv_loop_close(&loop_);
       }
 
       bool init() {
-        return uv_loop_init(&loop_) == 0;
+        if (uv_loop_init(&loop_) != 0) {
+          return false;
+        }
+        loop_.data = this;
+
+        if (uv_async_init(&loop_, &postAsync_, onPostCallback) != 0) {
+          uv_loop_close(&loop_);
+          return false;
+        }
+        postAsync_.data = this;
+        // posting tasks must not keep the loop alive on its own
+        uv_unref(reinterpret_cast<uv_handle_t *>(&postAsync_));
+
+        uv_prepare_init(&loop_, &deferredPrepare_);
+        uv_check_init(&loop_, &deferredCheck_);
+        deferredPrepare_.data = this;
+        deferredCheck_.data = this;
+
+        initialized_ = true;
+        return true;
       }
 
       uv_loop_t *getRaw() {
@@ -33,9 +109,202 @@ namespace uvcpp {
       void stop() {
         uv_stop(&loop_);
       }
-    
+
+      /**
+       * thread-safe, runs the task on the loop thread, tasks posted before
+       * the loop wakes up are all drained in one uv_async_send wakeup
+       */
+      void post(Task &&task) {
+        tasks_.push(std::move(task));
+        uv_async_send(&postAsync_);
+      }
+
+      /**
+       * destroys the tasks posted but not run yet, for a loop that won't
+       * run again, call it on the thread that ran the loop once nothing
+       * posts to it anymore
+       */
+      void dropPostedTasks() {
+        Task task;
+        while (tasks_.pop(task)) {
+          task = nullptr;
+        }
+      }
+
+      /**
+       * scratch read buffer shared by all the streams of this loop, EvRead
+       * is published synchronously from the read callback, so the buffer
+       * can be reused by the next read at once.
+       * used by streams when UVCPP_STREAM_SHARED_READ_BUF is defined
+       */
+      uv_buf_t getSharedReadBuffer() {
+#ifdef UVCPP_LOOP_READ_BUF_SIZE
+        const std::size_t size = UVCPP_LOOP_READ_BUF_SIZE;
+#else
+        const std::size_t size = 65536;
+#endif
+        if (!sharedReadBuf_) {
+          sharedReadBuf_.reset(new char[size]);
+        }
+        return uv_buf_init(sharedReadBuf_.get(), size);
+      }
+
+      /**
+       * loop thread only
+       */
+      BufferPool &getBufferPool() {
+        return bufferPool_;
+      }
+
+      /**
+       * coarse timers shared by the handles of this loop, ticking every
+       * UVCPP_LOOP_TIMER_WHEEL_TICK_MS (100 ms by default) while any entry
+       * is scheduled, created on first use, loop thread only
+       */
+      TimerWheel &getTimerWheel() {
+        if (!timerWheel_) {
+#ifdef UVCPP_LOOP_TIMER_WHEEL_TICK_MS
+          const uint64_t tickMs = UVCPP_LOOP_TIMER_WHEEL_TICK_MS;
+#else
+          const uint64_t tickMs = 100;
+#endif
+          timerWheel_.reset(new TimerWheel(&loop_, tickMs));
+        }
+        return *timerWheel_;
+      }
+
+      /**
+       * the Loop that owns the raw loop, for code that only has a handle
+       */
+      static Loop *fromRaw(uv_loop_t *loop) {
+        return reinterpret_cast<Loop *>(loop->data);
+      }
+
+      /**
+       * keeps run() from returning when there's no other active handle,
+       * so the loop can wait for posted tasks, call it on the loop thread
+       * or before run() is called
+       */
+      void setKeepAlive(bool keepAlive) {
+        auto handle = reinterpret_cast<uv_handle_t *>(&postAsync_);
+        if (keepAlive) {
+          uv_ref(handle);
+        } else {
+          uv_unref(handle);
+        }
+      }
+
+      /**
+       * schedules d to run at the end of the current loop iteration, does
+       * nothing if it is already scheduled, loop thread only
+       */
+      void defer(Deferred *d) {
+        if (d->loop_) {
+          return;
+        }
+
+        d->loop_ = this;
+        d->prev_ = deferredTail_;
+        d->next_ = nullptr;
+        if (deferredTail_) {
+          deferredTail_->next_ = d;
+        } else {
+          deferredHead_ = d;
+          // the handles are only active while there's deferred work, which
+          // also keeps the loop alive until the work is done
+          uv_prepare_start(&deferredPrepare_, onDeferredPrepareCallback);
+          uv_check_start(&deferredCheck_, onDeferredCheckCallback);
+        }
+        deferredTail_ = d;
+      }
+
+      void cancelDeferred(Deferred *d) {
+        if (d->loop_ != this) {
+          return;
+        }
+
+        if (d->prev_) {
+          d->prev_->next_ = d->next_;
+        } else {
+          deferredHead_ = d->next_;
+        }
+        if (d->next_) {
+          d->next_->prev_ = d->prev_;
+        } else {
+          deferredTail_ = d->prev_;
+        }
+        d->loop_ = nullptr;
+        d->prev_ = nullptr;
+        d->next_ = nullptr;
+
+        if (!deferredHead_) {
+          uv_prepare_stop(&deferredPrepare_);
+          uv_check_stop(&deferredCheck_);
+        }
+      }
+
+    private:
+      /**
+       * true if the handles left are all closing with close callbacks that
+       * don't reach user objects, the internal handles of the loop and the
+       * timers of TimerWheels
+       */
+      bool onlyOwnHandlesLeft() {
+        // the memory of an abandoned handle is gone, walking it is not safe
+        if (abandonedHandles_ != 0 || loop_.active_reqs.count != 0) {
+          return false;
+        }
+
+        auto foreign = false;
+        uv_walk(&loop_, [](uv_handle_t *h, void *arg) {
+          if (!uv_is_closing(h) || (h->close_cb != nullptr &&
+                h->close_cb != TimerWheel::onCloseCallback)) {
+            *reinterpret_cast<bool *>(arg) = true;
+          }
+        }, &foreign);
+        return !foreign;
+      }
+
+      void runDeferred() {
+        // work deferred while running is run in the same round
+        while (deferredHead_) {
+          auto d = deferredHead_;
+          cancelDeferred(d);
+          d->onDeferred();
+        }
+      }
+
+      static void onDeferredPrepareCallback(uv_prepare_t *prepare) {
+        reinterpret_cast<Loop *>(prepare->data)->runDeferred();
+      }
+
+      static void onDeferredCheckCallback(uv_check_t *check) {
+        reinterpret_cast<Loop *>(check->data)->runDeferred();
+      }
+
+      static void onPostCallback(uv_async_t *async) {
+        auto loop = reinterpret_cast<Loop *>(async->data);
+        Task task;
+        while (loop->tasks_.pop(task)) {
+          task();
+          task = nullptr;
+        }
+      }
+
     protected:
       uv_loop_t loop_;
+      uv_async_t postAsync_;
+      MPSCQueue<Task> tasks_;
+      uv_prepare_t deferredPrepare_;
+      uv_check_t deferredCheck_;
+      Deferred *deferredHead_{nullptr};
+      Deferred *deferredTail_{nullptr};
+      std::unique_ptr<char[]> sharedReadBuf_;
+      BufferPool bufferPool_;
+      std::unique_ptr<TimerWheel> timerWheel_;
+      // Handles destroyed before their close completed
+      std::size_t abandonedHandles_{0};
+      bool initialized_{false};
   };
 } /* end of namspace: uvcpp */
 
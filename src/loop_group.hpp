@@ -0,0 +1,329 @@
+/*******************************************************************************
+**          File: loop_group.hpp
+**        Author: neevek <i@neevek.net>.
+** Creation Time: 2026-10-17 Sat 10:12 AM
+**   Description: runs N Loops on dedicated threads
+*******************************************************************************/
+#ifndef UVCPP_LOOP_GROUP_H_
+#define UVCPP_LOOP_GROUP_H_
+#include "tcp.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+namespace uvcpp {
+
+  class LoopGroup final {
+    struct Worker {
+      std::shared_ptr<Loop> loop;
+      std::thread thread;
+      // the loop returned from run(), guarded by LoopGroup::mutex_
+      bool exited{false};
+    };
+
+    /**
+     * the descriptor of a dispatched client, closed unless it was opened
+     * on the worker loop, so it doesn't leak when the task is destroyed
+     * without running
+     */
+    struct DispatchedFd {
+      explicit DispatchedFd(int fd) : fd(fd) { }
+
+      ~DispatchedFd() {
+        if (fd != -1) {
+          ::close(fd);
+        }
+      }
+
+      int fd;
+    };
+
+    /**
+     * state of a listenSharded() call, shared by the caller and the tasks
+     * posted to the loops, which may outlive the call
+     */
+    struct ShardedListen {
+      void done(bool success) {
+        std::lock_guard<std::mutex> lock(mutex);
+        succeeded = succeeded && success;
+        if (--pending == 0) {
+          cond.notify_one();
+        }
+      }
+
+      std::mutex mutex;
+      std::condition_variable cond;
+      std::size_t pending;
+      bool succeeded{true};
+      SockAddrStorage sas;
+      int backlog;
+      std::function<void(const std::shared_ptr<Tcp> &)> setup;
+    };
+
+    /**
+     * reports a failure for the loop it is posted to if it is destroyed
+     * before running, because the post failed or the loop stopped first
+     */
+    struct ShardedListenTask {
+      explicit ShardedListenTask(const std::shared_ptr<ShardedListen> &state) :
+        state(state) { }
+
+      ~ShardedListenTask() {
+        if (state) {
+          state->done(false);
+        }
+      }
+
+      std::shared_ptr<ShardedListen> state;
+    };
+
+    public:
+      using AcceptCallback = std::function<void(const std::shared_ptr<Tcp> &)>;
+      using ListenerCallback =
+        std::function<void(const std::shared_ptr<Tcp> &)>;
+
+      /**
+       * size == 0 means one loop per hardware thread
+       */
+      explicit LoopGroup(std::size_t size = 0) : size_(size) {
+        if (size_ == 0) {
+          size_ = std::max(1u, std::thread::hardware_concurrency());
+        }
+      }
+
+      ~LoopGroup() {
+        stop();
+        join();
+      }
+
+      bool start() {
+        if (!workers_.empty()) {
+          LOG_W("LoopGroup already started");
+          return false;
+        }
+
+        for (std::size_t i = 0; i < size_; ++i) {
+          auto w = std::make_unique<Worker>();
+          w->loop = std::make_shared<Loop>();
+          if (!w->loop->init()) {
+            LOG_E("failed to init Loop for LoopGroup");
+            workers_.clear();
+            return false;
+          }
+          // keeps the loop running until stop() is called
+          w->loop->setKeepAlive(true);
+          workers_.push_back(std::move(w));
+        }
+
+        for (auto &w : workers_) {
+          auto worker = w.get();
+          w->thread = std::thread([this, worker]{
+            worker->loop->run();
+            {
+              std::lock_guard<std::mutex> lock(mutex_);
+              worker->exited = true;
+            }
+            // nothing is posted to the loop anymore, the tasks that didn't
+            // run are destroyed here, so that what they hold is released
+            worker->loop->dropPostedTasks();
+          });
+        }
+        return true;
+      }
+
+      /**
+       * thread-safe, asks all the loops to stop, handles still open on the
+       * worker loops are left to the caller, call join() to wait for the
+       * threads to exit, tasks posted after stop() are dropped
+       */
+      void stop() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopped_) {
+          return;
+        }
+        stopped_ = true;
+        for (auto &w : workers_) {
+          if (w->exited) {
+            continue;
+          }
+          auto loop = w->loop.get();
+          loop->post([loop]{
+            loop->setKeepAlive(false);
+            loop->stop();
+          });
+        }
+      }
+
+      void join() {
+        for (auto &w : workers_) {
+          if (w->thread.joinable()) {
+            w->thread.join();
+          }
+        }
+      }
+
+      /**
+       * thread-safe, runs the task on the loop at index, a task accepted
+       * here is either run, or destroyed without running if the loop
+       * stops first, it is destroyed at once if false is returned
+       */
+      bool post(std::size_t index, Loop::Task &&task) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (index >= workers_.size() || stopped_ || workers_[index]->exited) {
+          return false;
+        }
+        workers_[index]->loop->post(std::move(task));
+        return true;
+      }
+
+      std::size_t size() const {
+        return size_;
+      }
+
+      std::shared_ptr<Loop> getLoop(std::size_t index) const {
+        return index < workers_.size() ? workers_[index]->loop : nullptr;
+      }
+
+      /**
+       * round-robin index of the next worker loop
+       */
+      std::size_t nextIndex() {
+        return nextIndex_.fetch_add(1, std::memory_order_relaxed) % size_;
+      }
+
+      /**
+       * hands an accepted client (normally the one carried by EvAccept<Tcp>)
+       * over to the next worker loop, the client is closed on the current
+       * loop and reopened on the worker loop, where callback is called with
+       * the new Tcp, so the callback runs on the worker thread
+       */
+      bool dispatch(std::shared_ptr<Tcp> &&client, AcceptCallback &&callback) {
+        if (workers_.empty()) {
+          LOG_E("LoopGroup not started");
+          return false;
+        }
+
+        uv_os_fd_t fd;
+        int err;
+        if ((err = uv_fileno(
+              reinterpret_cast<uv_handle_t *>(client->get()), &fd)) != 0) {
+          LOG_E("uv_fileno failed: %s", uv_strerror(err));
+          return false;
+        }
+
+        // the descriptor is duplicated so that the client handle can be
+        // closed on the current loop without tearing down the connection
+        auto newFd = ::dup(fd);
+        if (newFd == -1) {
+          LOG_E("dup failed: %s", strerror(errno));
+          return false;
+        }
+
+        client->selfRefUntil<EvClose>();
+        client->close();
+        client.reset();
+
+        auto index = nextIndex();
+        auto loop = workers_[index]->loop;
+        auto cb = std::make_shared<AcceptCallback>(std::move(callback));
+        auto dupFd = std::make_shared<DispatchedFd>(newFd);
+        return post(index, [loop, dupFd, cb]{
+          auto tcp = Tcp::create(loop);
+          if (!tcp) {
+            return;
+          }
+          if (!tcp->open(dupFd->fd)) {
+            tcp->selfRefUntil<EvClose>();
+            tcp->close();
+            return;
+          }
+          // owned by the handle now
+          dupFd->fd = -1;
+          (*cb)(tcp);
+        });
+      }
+
+      /**
+       * sharded listening, every loop in the group binds its own
+       * SO_REUSEPORT socket on ip:port, so the kernel spreads incoming
+       * connections across the loops and no cross-thread handoff is needed.
+       *
+       * setup is called on each worker thread with the listening Tcp
+       * before listen() is called on it, register EvAccept<Tcp> there.
+       * the listeners keep themselves alive until closed.
+       *
+       * blocks until all the listeners are set up, must not be called
+       * from one of the loops in the group
+       */
+      bool listenSharded(
+        const std::string &ip, uint16_t port, int backlog,
+        ListenerCallback &&setup) {
+        if (workers_.empty()) {
+          LOG_E("LoopGroup not started");
+          return false;
+        }
+
+        SockAddrStorage sas;
+        if (!NetUtil::convertIPAddress(ip, port, &sas)) {
+          LOG_E("[%s] is not a valid ip address", ip.c_str());
+          return false;
+        }
+
+        // shared with the tasks, which are destroyed on the loop threads,
+        // run or not, possibly after the call returned
+        auto state = std::make_shared<ShardedListen>();
+        state->pending = workers_.size();
+        state->sas = sas;
+        state->backlog = backlog;
+        state->setup = std::move(setup);
+
+        for (std::size_t i = 0; i < workers_.size(); ++i) {
+          auto loop = workers_[i]->loop;
+          auto task = std::make_shared<ShardedListenTask>(state);
+          post(i, [loop, task]{
+            auto state = std::move(task->state);
+            auto server = Tcp::create(loop);
+            if (!server) {
+              state->done(false);
+              return;
+            }
+
+            server->selfRefUntil<EvClose>();
+            if (!server->bind(
+                  reinterpret_cast<SockAddr *>(&state->sas), true)) {
+              server->close();
+              state->done(false);
+              return;
+            }
+
+            state->setup(server);
+            if (!server->listen(state->backlog)) {
+              server->close();
+              state->done(false);
+              return;
+            }
+            state->done(true);
+          });
+        }
+
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->cond.wait(lock, [&state]{ return state->pending == 0; });
+        return state->succeeded;
+      }
+
+    private:
+      std::size_t size_;
+      std::vector<std::unique_ptr<Worker>> workers_;
+      std::atomic<std::size_t> nextIndex_{0};
+      // makes posting and stopping/exiting of the loops mutually exclusive
+      std::mutex mutex_;
+      bool stopped_{false};
+  };
+
+} /* end of namspace: uvcpp */
+
+#endif /* end of include guard: UVCPP_LOOP_GROUP_H_ */
@@ -0,0 +1,74 @@
+/*******************************************************************************
+**          File: mpsc_queue.hpp
+**        Author: neevek <i@neevek.net>.
+** Creation Time: 2026-10-17 Sat 02:05 PM
+**   Description: lock-free multi-producer single-consumer queue
+*******************************************************************************/
+#ifndef UVCPP_MPSC_QUEUE_H_
+#define UVCPP_MPSC_QUEUE_H_
+#include <atomic>
+#include <utility>
+
+namespace uvcpp {
+
+  /**
+   * Dmitry Vyukov's intrusive MPSC queue, push() is wait-free and can be
+   * called from any thread, pop() must only be called from one thread.
+   *
+   * pop() may return false while a push() is half way done, the producer
+   * is expected to notify the consumer after push() returns, so the value
+   * is picked up on the next round
+   */
+  template <typename T>
+  class MPSCQueue final {
+    struct Node {
+      Node() = default;
+      explicit Node(T &&value) : value(std::move(value)) { }
+      std::atomic<Node *> next{nullptr};
+      T value;
+    };
+
+    public:
+      MPSCQueue() : head_(new Node()), tail_(head_.load()) { }
+
+      ~MPSCQueue() {
+        T value;
+        while (pop(value)) { }
+        delete tail_;
+      }
+
+      MPSCQueue(const MPSCQueue &) = delete;
+      MPSCQueue &operator=(const MPSCQueue &) = delete;
+
+      void push(T &&value) {
+        auto node = new Node(std::move(value));
+        auto prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+      }
+
+      bool pop(T &value) {
+        auto tail = tail_;
+        auto next = tail->next.load(std::memory_order_acquire);
+        if (!next) {
+          return false;
+        }
+
+        // next becomes the new stub node, its value is moved out
+        value = std::move(next->value);
+        tail_ = next;
+        delete tail;
+        return true;
+      }
+
+      bool empty() const {
+        return tail_->next.load(std::memory_order_acquire) == nullptr;
+      }
+
+    private:
+      std::atomic<Node *> head_;
+      Node *tail_;
+  };
+
+} /* end of namspace: uvcpp */
+
+#endif /* end of include guard: UVCPP_MPSC_QUEUE_H_ */
@@ -37,6 +37,7 @@ namespace uvcpp {
           connectReq_ = ConnectReq::create(this->getLoop());
         }
         uv_pipe_connect(connectReq_->get(), get(), name.c_str(), onConnect);
+        this->startConnectDeadline();
       }
 
       bool sendTcpHandle(Tcp &tcp) {
@@ -150,6 +151,7 @@ namespace uvcpp {
     private:
       static void onConnect(uv_connect_t *req, int status) {
         auto pipe = reinterpret_cast<Pipe *>(req->handle->data);
+        pipe->stopConnectDeadline();
         if (status < 0) {
           LOG_E("onConnect failed: %s", uv_strerror(status));
           pipe->reportError("uv_pipe_connect", status);
@@ -0,0 +1,393 @@
+/*******************************************************************************
+**          File: relay.hpp
+**        Author: neevek <i@neevek.net>.
+** Creation Time: 2026-10-19 Mon 10:05 AM
+**   Description: relays bytes between two streams in both directions
+*******************************************************************************/
+#ifndef UVCPP_RELAY_H_
+#define UVCPP_RELAY_H_
+#include "stream.hpp"
+#include "poll.hpp"
+#include <cstdint>
+#include <functional>
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#endif
+
+namespace uvcpp {
+
+  /**
+   * pipes a to b and b to a until both sides shut down their writing side
+   * or one of them is closed, then closes both.
+   *
+   * COPY mode reads into buffers of the loop's BufferPool and moves them
+   * to the other side without copying, reading is paused while the other
+   * side has more than the high watermark queued. the buffers are sized to
+   * the reads (Stream::setAdaptiveReadBuffers), so small reads don't pin
+   * 64 KB each, and the memory held stays around twice the bytes queued.
+   * SPLICE mode (Linux only, falls back to COPY elsewhere or if it can't
+   * be set up) moves the bytes through a kernel pipe with splice(2),
+   * bypassing the streams' own read/write machinery, so the payload never
+   * enters user space.
+   *
+   * both streams must be connected and neither reading nor writing when
+   * start() is called, the relay keeps itself alive until it finishes
+   */
+  template <typename A, typename B = A>
+  class Relay final : public std::enable_shared_from_this<Relay<A, B>> {
+    public:
+      enum class Mode {
+        COPY,
+        SPLICE
+      };
+
+      using FinishCallback = std::function<void(const Relay &)>;
+
+      static std::shared_ptr<Relay> create(
+        const std::shared_ptr<A> &a, const std::shared_ptr<B> &b) {
+        return std::shared_ptr<Relay>(new Relay(a, b));
+      }
+
+      ~Relay() {
+#ifdef __linux__
+        closeSpliceResources();
+#endif
+      }
+
+      void setMode(Mode mode) {
+        mode_ = mode;
+      }
+
+      /**
+       * the actual mode after start()
+       */
+      Mode getMode() const {
+        return mode_;
+      }
+
+      /**
+       * write queue watermarks of both streams in COPY mode
+       */
+      void setWatermarks(std::size_t high, std::size_t low) {
+        highWatermark_ = high;
+        lowWatermark_ = low;
+      }
+
+      /**
+       * callback is called after both streams are closed
+       */
+      bool start(FinishCallback &&callback = nullptr) {
+        if (started_) {
+          LOG_W("Relay already started");
+          return false;
+        }
+        started_ = true;
+        callback_ = std::move(callback);
+
+        auto self = this->shared_from_this();
+        a_->template once<EvClose>(
+          [self](const auto &e, auto &a) { self->onStreamClosed(); });
+        b_->template once<EvClose>(
+          [self](const auto &e, auto &b) { self->onStreamClosed(); });
+
+#ifdef __linux__
+        if (mode_ == Mode::SPLICE && startSplice()) {
+          return true;
+        }
+#endif
+        mode_ = Mode::COPY;
+        startCopy(a_, b_, &bytesAToB_, &doneAToB_);
+        startCopy(b_, a_, &bytesBToA_, &doneBToA_);
+        return true;
+      }
+
+      /**
+       * closes both streams
+       */
+      void stop() {
+        if (stopped_) {
+          return;
+        }
+        stopped_ = true;
+#ifdef __linux__
+        closeSpliceResources();
+#endif
+        a_->close();
+        b_->close();
+      }
+
+      /**
+       * bytes read from a and handed over to b
+       */
+      uint64_t getBytesAToB() const {
+        return bytesAToB_;
+      }
+
+      /**
+       * bytes read from b and handed over to a
+       */
+      uint64_t getBytesBToA() const {
+        return bytesBToA_;
+      }
+
+    private:
+      Relay(const std::shared_ptr<A> &a, const std::shared_ptr<B> &b) :
+        a_(a), b_(b) { }
+
+      template <typename Src, typename Dst>
+      void startCopy(
+        const std::shared_ptr<Src> &src, const std::shared_ptr<Dst> &dst,
+        uint64_t *counter, bool *done) {
+        src->setAllowHalfOpen(true);
+        dst->setWriteWatermarks(highWatermark_, lowWatermark_);
+        dst->pauseReadingWhileFull(src);
+
+        // the buffers read into are handed to dst as they are, sized to the
+        // recent reads, so the memory they pin follows the queued bytes the
+        // watermarks count
+        src->setAdaptiveReadBuffers(
+          kMinCopyBufferSize, kInitialCopyBufferSize, kMaxCopyBufferSize);
+        auto rawDst = dst.get();
+        src->template on<EvRead>([rawDst, counter](const auto &e, auto &src) {
+          *counter += e.nread;
+          rawDst->writeAsync(std::move(e.buffer));
+        });
+        // shutdown is carried out after the queued writes are done, once
+        // only, reading may be resumed by the watermark callbacks after EOF
+        src->template once<EvEnd>([rawDst](const auto &e, auto &src) {
+          if (rawDst->isValid()) {
+            rawDst->shutdown();
+          }
+        });
+        dst->template once<EvShutdown>([this, done](const auto &e, auto &dst) {
+          *done = true;
+          onDirectionDone();
+        });
+        src->readStart();
+      }
+
+      void onDirectionDone() {
+        if (doneAToB_ && doneBToA_) {
+          stop();
+        }
+      }
+
+      void onStreamClosed() {
+        if (++closedCount_ == 1) {
+          stop();
+        } else if (callback_) {
+          auto callback = std::move(callback_);
+          callback(*this);
+        }
+      }
+
+#ifdef __linux__
+      struct SplicePipe {
+        int fds[2]{-1, -1};
+        std::size_t capacity{0};
+        // bytes sitting in the pipe
+        std::size_t pending{0};
+        bool srcEof{false};
+        // the pipe can't take more though pending < capacity
+        bool full{false};
+        bool writeBlocked{false};
+      };
+
+      static const int kSpliceFlags = SPLICE_F_MOVE | SPLICE_F_NONBLOCK;
+
+      bool startSplice() {
+        if (!dupFd(a_, &fds_[0]) || !dupFd(b_, &fds_[1])) {
+          closeSpliceResources();
+          return false;
+        }
+
+        for (auto &p : pipes_) {
+          if (pipe2(p.fds, O_NONBLOCK | O_CLOEXEC) == -1) {
+            LOG_E("pipe2 failed: %s", strerror(errno));
+            closeSpliceResources();
+            return false;
+          }
+          // a larger pipe means fewer wakeups, the default size is used
+          // if the limit in /proc/sys/fs/pipe-max-size is lower
+          fcntl(p.fds[1], F_SETPIPE_SZ, kPipeSize);
+          p.capacity = fcntl(p.fds[1], F_GETPIPE_SZ);
+        }
+
+        auto loop = a_->getLoop();
+        for (int side = 0; side < 2; ++side) {
+          auto poll = Poll::create(loop);
+          if (!poll || !poll->initWithSockHandle(fds_[side])) {
+            closeSpliceResources();
+            return false;
+          }
+          poll->template on<EvPoll>([this, side](const auto &e, auto &poll) {
+            onPoll(side, e.events);
+          });
+          poll->template once<EvError>([this](const auto &e, auto &poll) {
+            stop();
+          });
+          polls_[side] = poll;
+        }
+
+        updatePolls();
+        return true;
+      }
+
+      template <typename S>
+      bool dupFd(const std::shared_ptr<S> &stream, int *fd) {
+        uv_os_fd_t rawFd;
+        int err;
+        if ((err = uv_fileno(
+              reinterpret_cast<uv_handle_t *>(stream->get()), &rawFd)) != 0) {
+          LOG_E("uv_fileno failed: %s", uv_strerror(err));
+          return false;
+        }
+        // epoll can watch a duplicate while libuv owns the original
+        if ((*fd = fcntl(rawFd, F_DUPFD_CLOEXEC, 0)) == -1) {
+          LOG_E("dup failed: %s", strerror(errno));
+          return false;
+        }
+        return true;
+      }
+
+      /**
+       * side 0 is a, side 1 is b, pipes_[side] carries the bytes read from
+       * that side
+       */
+      void onPoll(int side, int events) {
+        if (events & Poll::READABLE) {
+          spliceIn(side);
+        }
+        if (!stopped_ && (events & Poll::WRITABLE)) {
+          spliceOut(1 - side);
+        }
+        if (!stopped_) {
+          updatePolls();
+        }
+      }
+
+      void spliceIn(int dir) {
+        auto &p = pipes_[dir];
+        auto n = splice(fds_[dir], nullptr, p.fds[1], nullptr,
+                        p.capacity - p.pending, kSpliceFlags);
+        if (n > 0) {
+          p.pending += n;
+          *(dir == 0 ? &bytesAToB_ : &bytesBToA_) += n;
+        } else if (n == 0) {
+          p.srcEof = true;
+        } else if (errno == EAGAIN) {
+          // the socket was readable, so it's the pipe that has no room
+          p.full = p.pending > 0;
+          return;
+        } else {
+          LOG_E("splice failed: %s", strerror(errno));
+          stop();
+          return;
+        }
+        spliceOut(dir);
+      }
+
+      void spliceOut(int dir) {
+        auto &p = pipes_[dir];
+        auto dstFd = fds_[1 - dir];
+        while (p.pending > 0) {
+          auto n = splice(p.fds[0], nullptr, dstFd, nullptr,
+                          p.pending, kSpliceFlags);
+          if (n > 0) {
+            p.pending -= n;
+            p.full = false;
+            p.writeBlocked = false;
+          } else if (n < 0 && errno == EAGAIN) {
+            p.writeBlocked = true;
+            return;
+          } else {
+            LOG_E("splice failed: %s", strerror(errno));
+            stop();
+            return;
+          }
+        }
+
+        auto done = dir == 0 ? &doneAToB_ : &doneBToA_;
+        if (p.srcEof && !*done) {
+          ::shutdown(dstFd, SHUT_WR);
+          *done = true;
+          onDirectionDone();
+        }
+      }
+
+      void updatePolls() {
+        for (int side = 0; side < 2; ++side) {
+          auto &out = pipes_[side];
+          auto &in = pipes_[1 - side];
+          auto events = 0;
+          if (!out.srcEof && !out.full && out.pending < out.capacity) {
+            events |= Poll::READABLE;
+          }
+          if (in.writeBlocked) {
+            events |= Poll::WRITABLE;
+          }
+          if (events != pollEvents_[side]) {
+            pollEvents_[side] = events;
+            if (events) {
+              polls_[side]->poll(events);
+            } else {
+              polls_[side]->stop();
+            }
+          }
+        }
+      }
+
+      void closeSpliceResources() {
+        for (int side = 0; side < 2; ++side) {
+          if (polls_[side]) {
+            // the fd must not be closed before the poll handle stops
+            polls_[side]->template selfRefUntil<EvClose>();
+            polls_[side]->close();
+            polls_[side].reset();
+          }
+          if (fds_[side] != -1) {
+            ::close(fds_[side]);
+            fds_[side] = -1;
+          }
+          for (auto &fd : pipes_[side].fds) {
+            if (fd != -1) {
+              ::close(fd);
+              fd = -1;
+            }
+          }
+        }
+      }
+#endif
+
+    private:
+      static const int kPipeSize = 1024 * 1024;
+      static const std::size_t kMinCopyBufferSize = 64;
+      static const std::size_t kInitialCopyBufferSize = 4 * 1024;
+      static const std::size_t kMaxCopyBufferSize = 64 * 1024;
+
+      std::shared_ptr<A> a_;
+      std::shared_ptr<B> b_;
+      Mode mode_{Mode::COPY};
+      std::size_t highWatermark_{1024 * 1024};
+      std::size_t lowWatermark_{256 * 1024};
+      FinishCallback callback_;
+      uint64_t bytesAToB_{0};
+      uint64_t bytesBToA_{0};
+      bool doneAToB_{false};
+      bool doneBToA_{false};
+      int closedCount_{0};
+      bool started_{false};
+      bool stopped_{false};
+#ifdef __linux__
+      int fds_[2]{-1, -1};
+      SplicePipe pipes_[2];
+      std::shared_ptr<Poll> polls_[2];
+      int pollEvents_[2]{0, 0};
+#endif
+  };
+
+} /* end of namspace: uvcpp */
+
+#endif /* end of include guard: UVCPP_RELAY_H_ */
@@ -35,16 +35,140 @@ namespace uvcpp {
 
   class WriteReq : public Req<uv_write_t, WriteReq> {
     public:
+      WriteReq(const std::shared_ptr<Loop> &loop) : Req(loop) { }
       WriteReq(const std::shared_ptr<Loop> &loop, std::unique_ptr<nul::Buffer> &&buffer) :
         Req(loop), buffer(std::move(buffer)) { }
+      WriteReq(const std::shared_ptr<Loop> &loop,
+               std::vector<std::unique_ptr<nul::Buffer>> &&buffers) :
+        Req(loop), buffers(std::move(buffers)) { }
       std::unique_ptr<nul::Buffer> buffer;
+      // set instead of buffer by scatter-gather writes
+      std::vector<std::unique_ptr<nul::Buffer>> buffers;
+      // bytes carried by the request, for write queue accounting
+      std::size_t bytes{0};
+      // link used by ReqQueue
+      WriteReq *next{nullptr};
   };
 
   class UdpSendReq : public Req<uv_udp_send_t, UdpSendReq> {
     public:
+      UdpSendReq(const std::shared_ptr<Loop> &loop) : Req(loop) { }
       UdpSendReq(const std::shared_ptr<Loop> &loop, std::unique_ptr<nul::Buffer> &&buffer) :
         Req(loop), buffer(std::move(buffer)) { }
       std::unique_ptr<nul::Buffer> buffer;
+      // link used by ReqQueue
+      UdpSendReq *next{nullptr};
+  };
+
+  /**
+   * in-flight requests of a handle in submission order, plus a free list
+   * of completed ones, both linked through R::next. requests are owned by
+   * the queue and recycled, so once warmed up, queuing a request neither
+   * allocates nor touches a shared_ptr refcount
+   */
+  template <typename R>
+  class ReqQueue final {
+    public:
+      ReqQueue() = default;
+      ReqQueue(const ReqQueue &) = delete;
+      ReqQueue &operator=(const ReqQueue &) = delete;
+
+      ~ReqQueue() {
+        destroy(head_);
+        destroy(free_);
+      }
+
+      /**
+       * takes a request from the free list, or creates one for the loop
+       * of owner, the request is not queued until push() is called
+       */
+      template <typename Owner>
+      R *acquire(Owner &owner) {
+        if (!free_) {
+          return new R(owner.getLoop());
+        }
+        auto req = free_;
+        free_ = req->next;
+        req->next = nullptr;
+        --freeCount_;
+        return req;
+      }
+
+      void push(R *req) {
+        req->next = nullptr;
+        if (tail_) {
+          tail_->next = req;
+        } else {
+          head_ = req;
+        }
+        tail_ = req;
+      }
+
+      /**
+       * dequeues the oldest in-flight request
+       */
+      R *pop() {
+        auto req = head_;
+        if (req) {
+          head_ = req->next;
+          if (!head_) {
+            tail_ = nullptr;
+          }
+          req->next = nullptr;
+        }
+        return req;
+      }
+
+      /**
+       * puts a popped or never pushed request back to the free list, its
+       * buffers must have been taken out
+       */
+      void release(R *req) {
+        if (freeCount_ >= maxFree_) {
+          delete req;
+          return;
+        }
+        req->next = free_;
+        free_ = req;
+        ++freeCount_;
+      }
+
+      bool empty() const {
+        return head_ == nullptr;
+      }
+
+      /**
+       * 0 disables recycling
+       */
+      void setMaxFree(std::size_t maxFree) {
+        maxFree_ = maxFree;
+        while (freeCount_ > maxFree_) {
+          auto req = free_;
+          free_ = req->next;
+          delete req;
+          --freeCount_;
+        }
+      }
+
+      std::size_t getFreeCount() const {
+        return freeCount_;
+      }
+
+    private:
+      static void destroy(R *req) {
+        while (req) {
+          auto next = req->next;
+          delete req;
+          req = next;
+        }
+      }
+
+    private:
+      R *head_{nullptr};
+      R *tail_{nullptr};
+      R *free_{nullptr};
+      std::size_t freeCount_{0};
+      std::size_t maxFree_{64};
   };
 
   class ConnectReq : public Req<uv_connect_t, ConnectReq> {
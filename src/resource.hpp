@@ -11,6 +11,8 @@
 #include <type_traits>
 #include <functional>
 #include <vector>
+#include <new>
+#include <cstddef>
 #include "uv.h"
 #include "loop.hpp"
 #include "nul/log.h"
@@ -31,14 +33,160 @@ namespace uvcpp {
   template <typename E, typename Derived>
   using EventCallback = std::function<void(const E &event, Derived &handle)>;
 
-  struct ICallback {
-    virtual ~ICallback() = default;
+  /**
+   * type-erased event callback, callables that fit in the inline buffer
+   * (lambdas capturing a few pointers, or a std::function) are stored
+   * in place, so registering and calling them never touches the heap
+   */
+  class CallbackSlot {
+    enum class Op {
+      MOVE,
+      DESTROY
+    };
+
+    using Invoker = void (*)(void *callable, const void *event, void *handle);
+    using Manager = void (*)(Op op, void *src, void *dst);
+
+#ifdef UVCPP_CALLBACK_INLINE_SIZE
+    static constexpr std::size_t kInlineSize = UVCPP_CALLBACK_INLINE_SIZE;
+#else
+    static constexpr std::size_t kInlineSize = 48;
+#endif
+
+    template <typename F>
+    using IsInline = std::integral_constant<bool,
+      sizeof(F) <= kInlineSize &&
+      alignof(F) <= alignof(std::max_align_t) &&
+      std::is_nothrow_move_constructible<F>::value>;
+
+    public:
+      CallbackSlot() = default;
+
+      template <typename E, typename Derived, typename F>
+      static CallbackSlot create(F &&f) {
+        CallbackSlot slot;
+        slot.emplace<E, Derived>(
+          std::forward<F>(f), IsInline<std::decay_t<F>>{});
+        return slot;
+      }
+
+      CallbackSlot(CallbackSlot &&other) noexcept {
+        moveFrom(other);
+      }
+
+      CallbackSlot &operator=(CallbackSlot &&other) noexcept {
+        if (this != &other) {
+          reset();
+          moveFrom(other);
+        }
+        return *this;
+      }
+
+      CallbackSlot(const CallbackSlot &) = delete;
+      CallbackSlot &operator=(const CallbackSlot &) = delete;
+
+      ~CallbackSlot() {
+        reset();
+      }
+
+      explicit operator bool() const {
+        return invoker_ != nullptr;
+      }
+
+      template <typename E, typename Derived>
+      void invoke(const E &event, Derived &handle) {
+        invoker_(&storage_, &event, &handle);
+      }
+
+    private:
+      template <typename E, typename Derived, typename F>
+      void emplace(F &&f, std::true_type) {
+        using Fn = std::decay_t<F>;
+        new (&storage_) Fn(std::forward<F>(f));
+        invoker_ = [](void *callable, const void *event, void *handle) {
+          (*static_cast<Fn *>(callable))(
+            *static_cast<const E *>(event), *static_cast<Derived *>(handle));
+        };
+        manager_ = [](Op op, void *src, void *dst) {
+          if (op == Op::MOVE) {
+            new (dst) Fn(std::move(*static_cast<Fn *>(src)));
+          }
+          static_cast<Fn *>(src)->~Fn();
+        };
+      }
+
+      template <typename E, typename Derived, typename F>
+      void emplace(F &&f, std::false_type) {
+        using Fn = std::decay_t<F>;
+        *reinterpret_cast<Fn **>(&storage_) = new Fn(std::forward<F>(f));
+        invoker_ = [](void *callable, const void *event, void *handle) {
+          (**static_cast<Fn **>(callable))(
+            *static_cast<const E *>(event), *static_cast<Derived *>(handle));
+        };
+        manager_ = [](Op op, void *src, void *dst) {
+          if (op == Op::MOVE) {
+            *static_cast<Fn **>(dst) = *static_cast<Fn **>(src);
+          } else {
+            delete *static_cast<Fn **>(src);
+          }
+        };
+      }
+
+      void moveFrom(CallbackSlot &other) {
+        if (other.manager_) {
+          other.manager_(Op::MOVE, &other.storage_, &storage_);
+        }
+        invoker_ = other.invoker_;
+        manager_ = other.manager_;
+        other.invoker_ = nullptr;
+        other.manager_ = nullptr;
+      }
+
+      void reset() {
+        if (manager_) {
+          manager_(Op::DESTROY, &storage_, nullptr);
+          invoker_ = nullptr;
+          manager_ = nullptr;
+        }
+      }
+
+    private:
+      std::aligned_storage_t<kInlineSize, alignof(std::max_align_t)> storage_;
+      Invoker invoker_{nullptr};
+      Manager manager_{nullptr};
   };
 
-  template <typename E, typename Derived>
-  struct Callback : public ICallback {
-    Callback(EventCallback<E, Derived> callback) : callback(callback) { }
-    EventCallback<E, Derived> callback;
+  /**
+   * callbacks of one event type, the first one is stored inline for the
+   * very common single listener case
+   */
+  struct CallbackList {
+    bool empty() const {
+      return !first && rest.empty();
+    }
+
+    void add(CallbackSlot &&slot) {
+      if (!first && rest.empty()) {
+        first = std::move(slot);
+      } else {
+        rest.push_back(std::make_unique<CallbackSlot>(std::move(slot)));
+      }
+    }
+
+    template <typename E, typename Derived>
+    void invoke(const E &event, Derived &handle) {
+      // callbacks registered while dispatching are not called this time
+      auto size = rest.size();
+      if (first) {
+        first.invoke(event, handle);
+      }
+      for (std::size_t i = 0; i < size; ++i) {
+        rest[i]->invoke(event, handle);
+      }
+    }
+
+    CallbackSlot first;
+    std::vector<std::unique_ptr<CallbackSlot>> rest;
   };
 
   template <typename T, typename Derived>
@@ -87,22 +235,20 @@ namespace uvcpp {
         once<E>([_ = shared_from_this()](const auto &e, auto &h){});
       }
 
-      template<typename E, typename =
+      template<typename E, typename F, typename =
         std::enable_if_t<std::is_base_of<Event, E>::value, E>>
-      void on(EventCallback<E, Derived> &&callback) {
+      void on(F &&callback) {
         static_assert(
           !std::is_same<E, EvRef>::value && !std::is_same<E, EvDestroy>::value,
           "EvRef/EvDestroy is not allowed to be registered with 'on'");
 
-        registerCallback<E, CallbackType::ALWAYS>(
-          std::forward<EventCallback<E, Derived>>(callback));
+        registerCallback<E, CallbackType::ALWAYS>(std::forward<F>(callback));
       }
 
-      template<typename E, typename =
+      template<typename E, typename F, typename =
         std::enable_if_t<std::is_base_of<Event, E>::value, E>>
-      void once(EventCallback<E, Derived> &&callback) {
-        registerCallback<E, CallbackType::ONCE>(
-          std::forward<EventCallback<E, Derived>>(callback));
+      void once(F &&callback) {
+        registerCallback<E, CallbackType::ONCE>(std::forward<F>(callback));
       }
 
       template<typename E, typename =
@@ -117,36 +263,37 @@ namespace uvcpp {
 
     private:
       template<
-        typename E, CallbackType t,
+        typename E, CallbackType t, typename F,
         typename = std::enable_if_t<std::is_base_of<Event, E>::value, E>>
-      void registerCallback(EventCallback<E, Derived> &&callback) {
+      void registerCallback(F &&callback) {
         auto &vec = t == CallbackType::ALWAYS ? callbacks_ : onceCallbacks_;
         auto index = getEventTypeIndex<E, t>();
         if (index >= vec.size()) {
           vec.resize(index + 1);
         }
-        vec[index].push_back(std::make_unique<Callback<E, Derived>>(
-            std::forward<EventCallback<E, Derived>>(callback)));
+        // lists are heap allocated so that they stay put when vec grows
+        // while one of their callbacks is running
+        if (!vec[index]) {
+          vec[index] = std::make_unique<CallbackList>();
+        }
+        vec[index]->add(
+          CallbackSlot::create<E, Derived>(std::forward<F>(callback)));
       }
 
       template<typename E, CallbackType t>
       void doCallback(E &&event) {
         auto index = getEventTypeIndex<E, t>();
         if (t == CallbackType::ALWAYS) {
-          if (index < callbacks_.size()) {
-            auto &tmp = callbacks_[index];
-            for (auto &c : tmp) {
-              static_cast<Callback<E, Derived> *>(c.get())->callback(
-                std::forward<E>(event), static_cast<Derived &>(*this));
-            }
-          }
-        } else if (index < onceCallbacks_.size()) {
-          std::vector<std::unique_ptr<ICallback>> tmp;
-          onceCallbacks_[index].swap(tmp);
-          for (auto &c : tmp) {
-            static_cast<Callback<E, Derived> *>(c.get())->callback(
-              std::forward<E>(event), static_cast<Derived &>(*this));
+          if (index < callbacks_.size() && callbacks_[index]) {
+            callbacks_[index]->invoke(event, static_cast<Derived &>(*this));
           }
+        } else if (index < onceCallbacks_.size() && onceCallbacks_[index] &&
+                   !onceCallbacks_[index]->empty()) {
+          // moving the list out is allocation free, the callbacks are
+          // destroyed after all of them are called, which may release
+          // the last reference to this object
+          auto tmp = std::move(*onceCallbacks_[index]);
+          tmp.invoke(event, static_cast<Derived &>(*this));
         }
       }
 
@@ -165,8 +312,8 @@ namespace uvcpp {
     private:
       std::shared_ptr<Loop> loop_;
       T resource_;
-      std::vector<std::vector<std::unique_ptr<ICallback>>> callbacks_;
-      std::vector<std::vector<std::unique_ptr<ICallback>>> onceCallbacks_;
+      std::vector<std::unique_ptr<CallbackList>> callbacks_;
+      std::vector<std::unique_ptr<CallbackList>> onceCallbacks_;
   };
 } /* end of namspace: uvcpp */
 
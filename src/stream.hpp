@@ -8,9 +8,12 @@
 #define UVCPP_STREAM_H_
 #include "handle.hpp"
 #include "req.hpp"
+#include "poll.hpp"
 #include "defs.h"
-#include <deque>
 #include <cassert>
+#include <cstdint>
+#include <fcntl.h>
+#include <unistd.h>
 
 namespace uvcpp {
   struct EvConnect : public Event { };
@@ -25,13 +28,75 @@ namespace uvcpp {
   struct EvRead : public Event {
     EvRead(const char *buf, ssize_t nread) :
       buf(buf), nread(nread) { }
+    EvRead(const char *buf, ssize_t nread,
+           std::unique_ptr<nul::Buffer> &&buffer) :
+      buf(buf), nread(nread), buffer(std::move(buffer)) { }
 
     const char *buf;
     ssize_t nread;
+    // with owned read buffers (see Stream::setReadBufferAllocator), the
+    // buffer buf points into, its length is nread. listeners may std::move()
+    // it to keep the data without copying, otherwise it is read into again
+    mutable std::unique_ptr<nul::Buffer> buffer;
   };
 
   struct EvWrite : public Event { };
   struct EvShutdown : public Event { };
+  // the peer shut down its writing side, see setAllowHalfOpen
+  struct EvEnd : public Event { };
+
+  struct EvSendFileProgress : public Event {
+    EvSendFileProgress(std::size_t sent) : sent(sent) { }
+    // bytes of the file sent so far
+    std::size_t sent;
+  };
+
+  struct EvSendFileFinish : public Event {
+    EvSendFileFinish(int status, std::size_t sent) :
+      status(status), sent(sent) { }
+    // 0, or a negative error code, UV_ECANCELED if the stream is closed
+    int status;
+    std::size_t sent;
+  };
+
+  /**
+   * the write queue reached the high watermark, see setWriteWatermarks
+   */
+  struct EvWriteQueueFull : public Event {
+    EvWriteQueueFull(std::size_t queuedBytes) : queuedBytes(queuedBytes) { }
+    std::size_t queuedBytes;
+  };
+
+  /**
+   * the write queue went down to the low watermark after being full
+   */
+  struct EvWriteQueueDrained : public Event {
+    EvWriteQueueDrained(std::size_t queuedBytes) : queuedBytes(queuedBytes) { }
+    std::size_t queuedBytes;
+  };
+
+  /**
+   * a deadline set on the stream passed, see Stream::setReadTimeout
+   */
+  struct EvTimeout : public Event {
+    enum class Kind {
+      // connect didn't complete in time
+      CONNECT,
+      // nothing was read for the read timeout while reading
+      READ,
+      // pending writes made no progress for the write timeout
+      WRITE,
+      // the lifetime of the stream ran out
+      LIFETIME
+    };
+
+    EvTimeout(Kind kind) : kind(kind) { }
+
+    Kind kind;
+    // the stream is closed after the event, unless a listener clears it,
+    // READ and WRITE timeouts are then counted again from now
+    mutable bool close{true};
+  };
 
   template <typename T, typename Derived>
     class Stream : public Handle<T, Derived> {
@@ -43,21 +108,54 @@ namespace uvcpp {
             return false;
           }
 
-          // if pendingReqs are not empty after being closed
+          // if writeReqs are not empty after being closed
           // the buffers should be recycled
           this->template once<EvClose>([this](const auto &e, auto &st){
-            if (!pendingReqs_.empty()) {
-              for (auto &r : pendingReqs_) {
-                this->template publish<EvBufferRecycled>(
-                  EvBufferRecycled{ std::move(r->buffer) });
-              }
-              pendingReqs_.clear();
+            while (auto req = writeReqs_.pop()) {
+              recycleBuffers(*req);
+              writeReqs_.release(req);
+            }
+            for (auto &b : corkedBuffers_) {
+              this->recycleBuffer(std::move(b));
+            }
+            corkedBuffers_.clear();
+            corkedBytes_ = 0;
+            queuedBytes_ = 0;
+            writeQueueFull_ = false;
+
+            if (sendFileJob_) {
+              cancelSendFile();
+            }
+            if (ownedReadBuf_ && readBufferFromPool_) {
+              this->getRawLoop()->getBufferPool().release(
+                std::move(ownedReadBuf_));
+            }
+            ownedReadBuf_.reset();
+
+            if (deadlineEntry_.isScheduled()) {
+              this->getRawLoop()->getTimerWheel().cancel(&deadlineEntry_);
             }
+            reading_ = false;
+            connectDeadline_ = 0;
+            lifetimeDeadline_ = 0;
           });
           return true;
         }
 
       public:
+        using ReadBufferAllocator =
+          std::function<std::unique_ptr<nul::Buffer>(std::size_t)>;
+
+        struct ReadStats {
+          // reads that returned data, and the bytes they returned
+          uint64_t reads{0};
+          uint64_t bytes{0};
+          // reads that filled the whole buffer
+          uint64_t fullReads{0};
+          // size of the buffer handed to the last read
+          std::size_t readSize{0};
+        };
+
         bool listen(int backlog) {
           int err;
           if ((err = uv_listen(reinterpret_cast<uv_stream_t *>(this->get()),
@@ -74,10 +172,19 @@ namespace uvcpp {
                 reinterpret_cast<uv_stream_t *>(this->get()),
                 onAllocCallback, onReadCallback)) != 0) {
             this->reportError("uv_read_start", err);
+            return;
+          }
+          if (!reading_) {
+            reading_ = true;
+            if (readTimeout_) {
+              lastReadAt_ = now();
+              armDeadline();
+            }
           }
         }
 
         void readStop() {
+          reading_ = false;
           int err;
           if ((err = uv_read_stop(
                 reinterpret_cast<uv_stream_t *>(this->get()))) != 0) {
@@ -85,6 +192,50 @@ namespace uvcpp {
           }
         }
 
+        /**
+         * deadlines in ms, 0 (the default) turns one off. they are checked
+         * on the coarse TimerWheel of the loop (see Loop::getTimerWheel),
+         * so a deadline passes up to a tick late, and a read or a write
+         * completing costs no timer operation. EvTimeout is published when
+         * a deadline passes, and the stream is closed afterwards unless a
+         * listener clears EvTimeout::close.
+         *
+         * the connect timeout applies to the next connect of Tcp or Pipe
+         */
+        void setConnectTimeout(uint64_t timeoutMs) {
+          connectTimeout_ = timeoutMs;
+        }
+
+        /**
+         * while reading (readStart), nothing was read for timeoutMs
+         */
+        void setReadTimeout(uint64_t timeoutMs) {
+          readTimeout_ = timeoutMs;
+          if (readTimeout_ && reading_) {
+            lastReadAt_ = now();
+            armDeadline();
+          }
+        }
+
+        /**
+         * while writes are pending, none of them completed for timeoutMs
+         */
+        void setWriteTimeout(uint64_t timeoutMs) {
+          writeTimeout_ = timeoutMs;
+          if (writeTimeout_ && !writeReqs_.empty()) {
+            lastWriteAt_ = now();
+            armDeadline();
+          }
+        }
+
+        /**
+         * the stream is timed out timeoutMs from now, whatever it is doing
+         */
+        void setLifetime(uint64_t timeoutMs) {
+          lifetimeDeadline_ = timeoutMs ? now() + timeoutMs : 0;
+          armDeadline();
+        }
+
         void shutdown() {
           if (!shutdownReq_) {
             shutdownReq_ = ShutdownReq::create(this->getLoop());
@@ -104,23 +255,293 @@ namespace uvcpp {
             return false;
           }
 
-          auto rawBuffer = buffer->asPod();
-          auto req = WriteReq::create(this->getLoop(), std::move(buffer));
-          auto rawReq = req->get();
-          pendingReqs_.push_back(std::move(req));
+          auto bytes = buffer->getLength();
+          if (cork_) {
+            corkedBuffers_.push_back(std::move(buffer));
+            this->getRawLoop()->defer(&corkFlusher_);
+            corkedBytes_ += bytes;
+            addQueuedBytes(bytes);
+            return true;
+          }
+
+          return doWrite(std::move(buffer), 0);
+        }
+
+        /**
+         * writes as much of buffer as the socket takes right away with
+         * uv_try_write, and queues only the rest with uv_write, so a small
+         * write to a stream with room in its socket buffer completes
+         * without a request or a loop iteration.
+         *
+         * the same events as writeAsync are published, but if the buffer is
+         * written at once, EvBufferRecycled and EvWrite are published before
+         * this returns, so register the callbacks before calling it.
+         * falls back to writeAsync in cork mode or while writes are pending
+         */
+        bool tryWrite(std::unique_ptr<nul::Buffer> &&buffer) {
+          if (!this->isValid()) {
+            return false;
+          }
+
+          if (cork_ || !writeReqs_.empty()) {
+            return writeAsync(std::move(buffer));
+          }
+
+          auto rawBuffer = reinterpret_cast<uv_buf_t *>(buffer->asPod());
+          auto n = uv_try_write(
+            reinterpret_cast<uv_stream_t *>(this->get()), rawBuffer, 1);
+          if (n == UV_EAGAIN || n == UV_ENOSYS) {
+            n = 0;
+          } else if (n < 0) {
+            this->recycleBuffer(std::move(buffer));
+            this->reportError("uv_try_write", n);
+            return false;
+          }
+
+          if (static_cast<std::size_t>(n) < rawBuffer->len) {
+            return doWrite(std::move(buffer), n);
+          }
+
+          this->recycleBuffer(std::move(buffer));
+          this->template publish<EvWrite>(EvWrite{});
+          return true;
+        }
+
+        /**
+         * writes all the buffers with one uv_write, EvBufferRecycled is
+         * published for each of them, and one EvWrite when they're written
+         */
+        bool writev(std::vector<std::unique_ptr<nul::Buffer>> &&buffers) {
+          if (!this->isValid()) {
+            return false;
+          }
+
+          if (cork_) {
+            std::size_t bytes = 0;
+            for (auto &b : buffers) {
+              bytes += b->getLength();
+              corkedBuffers_.push_back(std::move(b));
+            }
+            this->getRawLoop()->defer(&corkFlusher_);
+            corkedBytes_ += bytes;
+            addQueuedBytes(bytes);
+            return true;
+          }
+
+          if (buffers.empty()) {
+            return true;
+          }
+          return doWritev(buffers);
+        }
+
+        /**
+         * in cork mode, buffers passed to writeAsync/writev are queued and
+         * written with a single multi-buffer uv_write at the end of the
+         * current loop iteration, so one EvWrite is published per batch,
+         * turning cork mode off flushes the queued buffers immediately
+         */
+        void setCork(bool cork) {
+          cork_ = cork;
+          if (!cork_) {
+            flush();
+          }
+        }
+
+        bool isCorked() const {
+          return cork_;
+        }
+
+        /**
+         * EvWriteQueueFull is published when the bytes queued for writing
+         * reach high, and EvWriteQueueDrained when they go down to low
+         * afterwards, high == 0 (the default) disables the events
+         */
+        void setWriteWatermarks(std::size_t high, std::size_t low) {
+          assert(high == 0 || low < high);
+          highWatermark_ = high;
+          lowWatermark_ = low;
+          if (writeQueueFull_ && (high == 0 || queuedBytes_ <= low)) {
+            writeQueueFull_ = false;
+            this->template
+              publish<EvWriteQueueDrained>(EvWriteQueueDrained{ queuedBytes_ });
+          } else {
+            addQueuedBytes(0);
+          }
+        }
+
+        /**
+         * bytes passed to writeAsync/writev (corked ones included) that are
+         * not written yet, unlike uv_stream_get_write_queue_size, which only
+         * counts what libuv failed to write at once, this is the memory the
+         * stream is holding on to
+         */
+        std::size_t getWriteQueueSize() const {
+          return queuedBytes_;
+        }
+
+        bool isWriteQueueFull() const {
+          return writeQueueFull_;
+        }
+
+        /**
+         * reads go into buffers returned by allocator (called with the size
+         * suggested by libuv) instead of the stream's internal buffer, and
+         * EvRead carries the buffer, so it can be handed to a parser, a
+         * queue, or writeAsync without copying. a buffer that is not taken
+         * by the listeners is reused for the next read.
+         * nullptr restores the default mode
+         */
+        void setReadBufferAllocator(ReadBufferAllocator &&allocator) {
+          readBufferAllocator_ = std::move(allocator);
+          readBufferFromPool_ = false;
+          adaptiveReadSize_ = 0;
+        }
+
+        /**
+         * owned read buffers of the given size from the BufferPool of the loop
+         */
+        void setOwnedReadBuffers(std::size_t size) {
+          auto pool = &this->getRawLoop()->getBufferPool();
+          setReadBufferAllocator([pool, size](std::size_t) {
+            return pool->acquire(size);
+          });
+          readBufferFromPool_ = true;
+        }
+
+        /**
+         * owned read buffers from the BufferPool of the loop, sized to the
+         * traffic: the size is doubled after a read that fills the buffer,
+         * and halved after two reads in a row that fit in half of it, within
+         * [minSize, maxSize]. bulk transfers end up with fewer, larger reads,
+         * idle connections with small buffers
+         */
+        void setAdaptiveReadBuffers(
+          std::size_t minSize = 64, std::size_t initialSize = 4096,
+          std::size_t maxSize = 64 * 1024) {
+          assert(minSize > 0 && minSize <= initialSize && initialSize <= maxSize);
+          auto pool = &this->getRawLoop()->getBufferPool();
+          setReadBufferAllocator([this, pool](std::size_t) {
+            return pool->acquire(adaptiveReadSize_);
+          });
+          readBufferFromPool_ = true;
+          adaptiveMinSize_ = minSize;
+          adaptiveMaxSize_ = maxSize;
+          adaptiveReadSize_ = initialSize;
+          adaptiveShrinkVotes_ = 0;
+        }
+
+        const ReadStats &getReadStats() const {
+          return readStats_;
+        }
+
+        /**
+         * by default the stream is closed when the peer shuts down its
+         * writing side, with half open allowed, EvEnd is published instead
+         * and the stream can still be written to until it is closed
+         */
+        void setAllowHalfOpen(bool allowHalfOpen) {
+          allowHalfOpen_ = allowHalfOpen;
+        }
 
+        /**
+         * stops reading on source while the write queue of this stream is
+         * full, and starts reading again once it is drained, typically used
+         * with source being the stream whose data is written to this one,
+         * calling it again replaces the source
+         */
+        template <typename S>
+        void pauseReadingWhileFull(const std::shared_ptr<S> &source) {
+          std::weak_ptr<S> weakSource = source;
+          auto registered = !!pauseSource_;
+          pauseSource_ = [weakSource](bool pause) {
+            auto s = weakSource.lock();
+            if (s && s->isValid()) {
+              if (pause) {
+                s->readStop();
+              } else {
+                s->readStart();
+              }
+            }
+          };
+          // listeners can't be removed, they are only registered once
+          if (registered) {
+            return;
+          }
+          this->template on<EvWriteQueueFull>([](const auto &e, auto &st) {
+            st.pauseSource_(true);
+          });
+          this->template on<EvWriteQueueDrained>([](const auto &e, auto &st) {
+            st.pauseSource_(false);
+          });
+        }
+
+        /**
+         * writes the buffers queued in cork mode
+         */
+        void flush() {
+          this->getRawLoop()->cancelDeferred(&corkFlusher_);
+          // buffers queued after the handle is closing are recycled on EvClose
+          if (corkedBuffers_.empty() || !this->isValid()) {
+            return;
+          }
+
+          // counted again by doWritev
+          queuedBytes_ -= corkedBytes_;
+          corkedBytes_ = 0;
+          doWritev(corkedBuffers_);
+        }
+
+        /**
+         * sends length bytes (0 for all) of the file from offset with
+         * uv_fs_sendfile, the file is read and written by the kernel on a
+         * threadpool thread, no buffer is involved, and the loop doesn't
+         * wait for the disk. EvSendFileProgress is published after each
+         * chunk and EvSendFileFinish when done, failed, or cancelled by
+         * closing the stream. errors don't close the stream.
+         *
+         * queued writes are sent first, nothing should be written to the
+         * stream until EvSendFileFinish, one file at a time
+         */
+        bool sendFile(
+          const std::string &path, int64_t offset = 0, std::size_t length = 0) {
+          if (!this->isValid() || sendFileJob_) {
+            return false;
+          }
+
+          auto job = new SendFileJob(this, offset, length);
+          job->ownsFile = true;
           int err;
-          if ((err = uv_write(
-                rawReq,
-                reinterpret_cast<uv_stream_t *>(this->get()),
-                reinterpret_cast<uv_buf_t *>(rawBuffer),
-                1, onWriteCallback)) != 0) {
-            this->reportError("uv_write", err);
+          if ((err = uv_fs_open(
+                job->loop, &job->req, path.c_str(), O_RDONLY, 0,
+                onSendFileOpenCallback)) != 0) {
+            LOG_E("uv_fs_open(\"%s\"): %s", path.c_str(), uv_strerror(err));
+            delete job;
             return false;
           }
+          job->inFlight = true;
+          sendFileJob_ = job;
           return true;
         }
 
+        /**
+         * same as above, file is left open
+         */
+        bool sendFile(uv_file file, int64_t offset = 0, std::size_t length = 0) {
+          if (!this->isValid() || sendFileJob_) {
+            return false;
+          }
+
+          auto job = new SendFileJob(this, offset, length);
+          job->file = file;
+          sendFileJob_ = job;
+          startSendFile();
+          return true;
+        }
+
+        bool isSendingFile() const {
+          return sendFileJob_ != nullptr;
+        }
+
         /**
          * > 0: number of bytes written (can be less than the supplied buffer size).
          * < 0: negative error code (UV_EAGAIN is returned if no data can be sent immediately).
@@ -139,6 +560,125 @@ namespace uvcpp {
       protected:
         virtual void doAccept() = 0;
 
+        /**
+         * for Tcp and Pipe, around their connect requests
+         */
+        void startConnectDeadline() {
+          if (connectTimeout_) {
+            connectDeadline_ = now() + connectTimeout_;
+            armDeadline();
+          }
+        }
+
+        void stopConnectDeadline() {
+          connectDeadline_ = 0;
+        }
+
+        void pushWriteReq(WriteReq *req) {
+          auto wasEmpty = writeReqs_.empty();
+          writeReqs_.push(req);
+          if (writeTimeout_ && wasEmpty) {
+            lastWriteAt_ = now();
+            armDeadline();
+          }
+        }
+
+        /**
+         * queues buffer, skipping the first offset bytes of it
+         */
+        bool doWrite(std::unique_ptr<nul::Buffer> &&buffer, std::size_t offset) {
+          auto rawBuffer = reinterpret_cast<uv_buf_t *>(buffer->asPod());
+          auto buf = uv_buf_init(
+            rawBuffer->base + offset, rawBuffer->len - offset);
+          auto req = writeReqs_.acquire(*this);
+          req->buffer = std::move(buffer);
+          req->bytes = buf.len;
+
+          int err;
+          if ((err = uv_write(
+                req->get(),
+                reinterpret_cast<uv_stream_t *>(this->get()),
+                &buf, 1, onWriteCallback)) != 0) {
+            discardWriteReq(req);
+            this->reportError("uv_write", err);
+            return false;
+          }
+          pushWriteReq(req);
+          addQueuedBytes(buf.len);
+          return true;
+        }
+
+        /**
+         * the buffers are swapped into the request, so buffers is left with
+         * the (empty) vector of a recycled request and its capacity
+         */
+        bool doWritev(std::vector<std::unique_ptr<nul::Buffer>> &buffers) {
+          std::size_t bytes = 0;
+          iovs_.clear();
+          for (auto &b : buffers) {
+            bytes += b->getLength();
+            iovs_.push_back(*reinterpret_cast<uv_buf_t *>(b->asPod()));
+          }
+
+          auto req = writeReqs_.acquire(*this);
+          req->buffers.swap(buffers);
+          req->bytes = bytes;
+
+          // libuv copies the uv_buf_t array into the request
+          int err;
+          if ((err = uv_write(
+                req->get(),
+                reinterpret_cast<uv_stream_t *>(this->get()),
+                iovs_.data(), iovs_.size(), onWriteCallback)) != 0) {
+            discardWriteReq(req);
+            this->reportError("uv_write", err);
+            return false;
+          }
+          pushWriteReq(req);
+          addQueuedBytes(bytes);
+          return true;
+        }
+
+        /**
+         * for requests libuv did not accept, no callback will be called
+         */
+        void discardWriteReq(WriteReq *req) {
+          recycleBuffers(*req);
+          writeReqs_.release(req);
+        }
+
+        void addQueuedBytes(std::size_t bytes) {
+          queuedBytes_ += bytes;
+          if (!writeQueueFull_ && highWatermark_ > 0 &&
+              queuedBytes_ >= highWatermark_) {
+            writeQueueFull_ = true;
+            this->template
+              publish<EvWriteQueueFull>(EvWriteQueueFull{ queuedBytes_ });
+          }
+        }
+
+        void removeQueuedBytes(std::size_t bytes) {
+          queuedBytes_ -= bytes;
+          if (writeQueueFull_ && queuedBytes_ <= lowWatermark_) {
+            writeQueueFull_ = false;
+            this->template
+              publish<EvWriteQueueDrained>(EvWriteQueueDrained{ queuedBytes_ });
+          }
+        }
+
+        void recycleBuffers(WriteReq &req) {
+          // req.buffer may be std::moved() in EvError callback
+          if (req.buffer) {
+            this->recycleBuffer(std::move(req.buffer));
+          }
+          for (auto &b : req.buffers) {
+            if (b) {
+              this->recycleBuffer(std::move(b));
+            }
+          }
+          req.buffers.clear();
+        }
+
         bool sendHandle(uv_stream_t *handle) {
           auto currentHandleType = this->get()->type;
           // can only send handle over a pipe
@@ -156,27 +696,44 @@ namespace uvcpp {
           auto buffer = std::make_unique<nul::Buffer>(1);
           buffer->setLength(1);
           auto rawBuffer = buffer->asPod();
-          auto req = WriteReq::create(this->getLoop(), std::move(buffer));
-          auto rawReq = req->get();
-          pendingReqs_.push_back(std::move(req));
+          auto req = writeReqs_.acquire(*this);
+          req->buffer = std::move(buffer);
+          req->bytes = 0;
 
           int err;
           if ((err = uv_write2(
-                rawReq,
+                req->get(),
                 reinterpret_cast<uv_stream_t *>(this->get()),
                 reinterpret_cast<uv_buf_t *>(rawBuffer),
                 1, handle, onWriteCallback)) != 0) {
+            discardWriteReq(req);
             this->reportError("uv_write2", err);
             return false;
           }
+          pushWriteReq(req);
           return true;
         }
 
         static void onAllocCallback(
           uv_handle_t *handle, std::size_t size, uv_buf_t *buf) {
           auto st = reinterpret_cast<Stream *>(handle->data);
-          buf->base = st->readBuf_;
-          buf->len = sizeof(st->readBuf_);
+          if (st->readBufferAllocator_) {
+            if (!st->ownedReadBuf_) {
+              st->ownedReadBuf_ = st->readBufferAllocator_(size);
+            }
+            // a null buffer fails the read with UV_ENOBUFS
+            auto &b = st->ownedReadBuf_;
+            *buf = b ? uv_buf_init(b->getData(), b->getCapacity()) :
+                       uv_buf_init(nullptr, 0);
+          } else {
+#ifdef UVCPP_STREAM_SHARED_READ_BUF
+            *buf = Loop::fromRaw(handle->loop)->getSharedReadBuffer();
+#else
+            buf->base = st->readBuf_;
+            buf->len = sizeof(st->readBuf_);
+#endif
+          }
+          st->readStats_.readSize = buf->len;
         }
 
         static void onReadCallback(
@@ -187,6 +744,11 @@ namespace uvcpp {
 
           auto st = reinterpret_cast<Stream *>(handle->data);
           if (nread < 0) {
+            if (nread == UV_EOF && st->allowHalfOpen_) {
+              st->reading_ = false;
+              st->template publish<EvEnd>(EvEnd{});
+              return;
+            }
             if (nread != UV_EOF) {
               LOG_E("TCP read failed: %s", uv_strerror(nread));
             }
@@ -194,21 +756,77 @@ namespace uvcpp {
             return;
           }
 
+          if (st->readTimeout_) {
+            st->lastReadAt_ = st->now();
+          }
+          ++st->readStats_.reads;
+          st->readStats_.bytes += nread;
+          if (static_cast<std::size_t>(nread) == buf->len) {
+            ++st->readStats_.fullReads;
+          }
+
+          auto &owned = st->ownedReadBuf_;
+          if (owned && buf->base == owned->getData()) {
+            owned->setLength(nread);
+            EvRead event{ buf->base, nread, std::move(owned) };
+            st->template publish<EvRead>(std::move(event));
+            if (event.buffer && !owned) {
+              owned = std::move(event.buffer);
+            }
+            if (st->adaptiveReadSize_) {
+              st->adaptReadSize(nread, buf->len);
+            }
+            return;
+          }
+
           st->template publish<EvRead>(EvRead{ buf->base, nread });
         }
 
-        static void onWriteCallback(uv_write_t *req, int status) {
-          auto st = reinterpret_cast<Stream *>(req->handle->data);
-          if (!st->pendingReqs_.empty()) {
-            auto req = std::move(st->pendingReqs_.front());
-            st->pendingReqs_.pop_front();
+        void adaptReadSize(std::size_t nread, std::size_t capacity) {
+          auto size = adaptiveReadSize_;
+          if (nread == capacity) {
+            adaptiveShrinkVotes_ = 0;
+            size = capacity * 2;
+          } else if (nread <= capacity / 2) {
+            if (++adaptiveShrinkVotes_ == 2) {
+              adaptiveShrinkVotes_ = 0;
+              size = capacity / 2;
+            }
+          } else {
+            adaptiveShrinkVotes_ = 0;
+          }
 
-            // req->buffer may be std::moved() in EvError callback
-            if (req->buffer) {
-              st->template publish<EvBufferRecycled>(
-                EvBufferRecycled{ std::move(req->buffer) });
+          size = size < adaptiveMinSize_ ? adaptiveMinSize_ :
+            size > adaptiveMaxSize_ ? adaptiveMaxSize_ : size;
+          if (size != adaptiveReadSize_) {
+            adaptiveReadSize_ = size;
+            // not taken by the listeners but of the old size, the next read
+            // gets a new one
+            if (ownedReadBuf_ && ownedReadBuf_->getCapacity() != size) {
+              this->getRawLoop()->getBufferPool().release(
+                std::move(ownedReadBuf_));
             }
           }
+        }
+
+        static void onWriteCallback(uv_write_t *rawReq, int status) {
+          auto st = reinterpret_cast<Stream *>(rawReq->handle->data);
+          // stream writes complete in the order they are submitted
+          auto req = st->writeReqs_.pop();
+          assert(req && req->get() == rawReq);
+          auto bytes = req->bytes;
+          st->recycleBuffers(*req);
+          st->writeReqs_.release(req);
+          st->removeQueuedBytes(bytes);
+          if (st->writeTimeout_) {
+            st->lastWriteAt_ = st->now();
+          }
+
+          auto job = st->sendFileJob_;
+          if (job && job->waitingForWrites && st->writeReqs_.empty()) {
+            job->waitingForWrites = false;
+            st->sendFileChunk();
+          }
 
           if (status < 0) {
             st->reportError("write", status);
@@ -232,14 +850,357 @@ namespace uvcpp {
           req->template publish<EvShutdown>(EvShutdown{});
         }
 
+        void startSendFile() {
+          flush();
+          if (!writeReqs_.empty()) {
+            sendFileJob_->waitingForWrites = true;
+            return;
+          }
+          sendFileChunk();
+        }
+
+        void sendFileChunk() {
+#ifdef __linux__
+          // libuv (1.30) calls sendfile(2) on the non-blocking socket, which
+          // fails with EAGAIN once the socket buffer is full, the next chunk
+          // is only handed to the threadpool when the socket can take it,
+          // so no pool thread is spent on a slow peer
+          waitWritableForSendFile();
+#else
+          sendFileNow();
+#endif
+        }
+
+        void sendFileNow() {
+          auto job = sendFileJob_;
+          uv_os_fd_t outFd;
+          int err;
+          if ((err = uv_fileno(
+                reinterpret_cast<uv_handle_t *>(this->get()), &outFd)) != 0) {
+            finishSendFile(err);
+            return;
+          }
+
+          // the file may not be cached, so the disk read is never made on
+          // the loop thread
+          auto length = job->remaining < kSendFileChunkSize ?
+            job->remaining : kSendFileChunkSize;
+          if ((err = uv_fs_sendfile(
+                job->loop, &job->req, outFd, job->file, job->offset, length,
+                onSendFileCallback)) != 0) {
+            finishSendFile(err);
+            return;
+          }
+          job->inFlight = true;
+        }
+
+        void onSendFileResult(ssize_t result) {
+          auto job = sendFileJob_;
+          if (result == UV_EAGAIN) {
+            waitWritableForSendFile();
+          } else if (result < 0) {
+            finishSendFile(result);
+          } else if (result == 0) {
+            // end of file
+            finishSendFile(0);
+          } else {
+            job->offset += result;
+            job->sent += result;
+            job->remaining -= result;
+            this->template
+              publish<EvSendFileProgress>(EvSendFileProgress{ job->sent });
+            // the listener may have closed the stream
+            if (sendFileJob_ != job) {
+              return;
+            }
+            if (job->remaining == 0) {
+              finishSendFile(0);
+            } else {
+              sendFileChunk();
+            }
+          }
+        }
+
+        /**
+         * waits for the socket to be writable through a duplicate of the
+         * fd, which epoll watches independently of the one owned by libuv
+         */
+        void waitWritableForSendFile() {
+          auto job = sendFileJob_;
+          if (!job->poll) {
+            uv_os_fd_t outFd;
+            int err;
+            if ((err = uv_fileno(
+                  reinterpret_cast<uv_handle_t *>(this->get()), &outFd)) != 0) {
+              finishSendFile(err);
+              return;
+            }
+            if ((job->pollFd = fcntl(outFd, F_DUPFD_CLOEXEC, 0)) == -1) {
+              finishSendFile(uv_translate_sys_error(errno));
+              return;
+            }
+            auto poll = Poll::create(this->getLoop());
+            if (!poll || !poll->initWithSockHandle(job->pollFd)) {
+              finishSendFile(UV_EIO);
+              return;
+            }
+            poll->template on<EvPoll>([this](const auto &e, auto &poll) {
+              poll.stop();
+              sendFileNow();
+            });
+            job->poll = poll;
+          }
+          job->poll->poll(Poll::WRITABLE);
+        }
+
+        void finishSendFile(int status) {
+          auto job = sendFileJob_;
+          auto sent = job->sent;
+          sendFileJob_ = nullptr;
+          destroySendFileJob(job);
+          this->template
+            publish<EvSendFileFinish>(EvSendFileFinish{ status, sent });
+        }
+
+        void cancelSendFile() {
+          auto job = sendFileJob_;
+          if (job->inFlight) {
+            // destroyed in the callback, which is still to be called
+            job->stream = nullptr;
+            uv_cancel(reinterpret_cast<uv_req_t *>(&job->req));
+            auto sent = job->sent;
+            sendFileJob_ = nullptr;
+            this->template publish<EvSendFileFinish>(
+              EvSendFileFinish{ UV_ECANCELED, sent });
+          } else {
+            finishSendFile(UV_ECANCELED);
+          }
+        }
+
+        static void onSendFileOpenCallback(uv_fs_t *req) {
+          auto job = reinterpret_cast<SendFileJob *>(req->data);
+          auto result = req->result;
+          uv_fs_req_cleanup(req);
+          job->inFlight = false;
+          if (result >= 0) {
+            job->file = result;
+          }
+          if (!job->stream) {
+            destroySendFileJob(job);
+          } else if (result < 0) {
+            job->stream->finishSendFile(result);
+          } else {
+            job->stream->startSendFile();
+          }
+        }
+
+        static void onSendFileCallback(uv_fs_t *req) {
+          auto job = reinterpret_cast<SendFileJob *>(req->data);
+          auto result = req->result;
+          uv_fs_req_cleanup(req);
+          job->inFlight = false;
+          if (job->stream) {
+            job->stream->onSendFileResult(result);
+          } else {
+            destroySendFileJob(job);
+          }
+        }
+
       private:
-        std::deque<std::shared_ptr<WriteReq>> pendingReqs_;
+        struct SendFileJob {
+          SendFileJob(Stream *stream, int64_t offset, std::size_t length) :
+            stream(stream),
+            loop(reinterpret_cast<uv_handle_t *>(stream->get())->loop),
+            offset(offset),
+            remaining(length > 0 ? length : SIZE_MAX) {
+            req.data = this;
+          }
+
+          // null once cancelled
+          Stream *stream;
+          uv_loop_t *loop;
+          uv_fs_t req;
+          uv_file file{-1};
+          bool ownsFile{false};
+          bool inFlight{false};
+          bool waitingForWrites{false};
+          int64_t offset;
+          std::size_t remaining;
+          std::size_t sent{0};
+          std::shared_ptr<Poll> poll;
+          int pollFd{-1};
+        };
+
+        static void destroySendFileJob(SendFileJob *job) {
+          if (job->poll) {
+            job->poll->template selfRefUntil<EvClose>();
+            job->poll->close();
+          }
+          if (job->pollFd != -1) {
+            ::close(job->pollFd);
+          }
+          if (job->ownsFile && job->file >= 0) {
+            uv_fs_t req;
+            uv_fs_close(job->loop, &req, job->file, nullptr);
+            uv_fs_req_cleanup(&req);
+          }
+          delete job;
+        }
+
+        static const std::size_t kSendFileChunkSize = 4 * 1024 * 1024;
+
+        struct DeadlineEntry : public TimerWheel::Entry {
+          DeadlineEntry(Stream *stream) : stream(stream) { }
+          virtual void onTimeout() override {
+            stream->onDeadline();
+          }
+          Stream *stream;
+        };
+
+        uint64_t now() {
+          return uv_now(reinterpret_cast<uv_handle_t *>(this->get())->loop);
+        }
+
+        /**
+         * the earliest deadline running, 0 if none
+         */
+        uint64_t nextDeadline() {
+          uint64_t next = 0;
+          auto consider = [&next](uint64_t at) {
+            if (at && (!next || at < next)) {
+              next = at;
+            }
+          };
+          consider(connectDeadline_);
+          consider(lifetimeDeadline_);
+          if (writeTimeout_ && !writeReqs_.empty()) {
+            consider(lastWriteAt_ + writeTimeout_);
+          }
+          if (readTimeout_ && reading_) {
+            consider(lastReadAt_ + readTimeout_);
+          }
+          return next;
+        }
+
+        /**
+         * one wheel entry per stream serves all the deadlines, it is only
+         * moved earlier here, reads and writes push their deadlines later
+         * without touching it, and it is re-armed for them when it fires
+         */
+        void armDeadline() {
+          auto next = nextDeadline();
+          if (!next || (deadlineEntry_.isScheduled() && deadlineAt_ <= next)) {
+            return;
+          }
+          auto current = now();
+          deadlineAt_ = next;
+          this->getRawLoop()->getTimerWheel().schedule(
+            &deadlineEntry_, next > current ? next - current : 0);
+        }
+
+        /**
+         * returns false if the stream is closed for the timeout
+         */
+        bool timeout(EvTimeout::Kind kind) {
+          EvTimeout event{ kind };
+          this->template publish<EvTimeout>(std::move(event));
+          if (event.close) {
+            this->close();
+          }
+          return this->isValid();
+        }
+
+        void onDeadline() {
+          if (!this->isValid()) {
+            return;
+          }
+
+          auto current = now();
+          if (connectDeadline_ && connectDeadline_ <= current) {
+            connectDeadline_ = 0;
+            if (!timeout(EvTimeout::Kind::CONNECT)) {
+              return;
+            }
+          }
+          if (lifetimeDeadline_ && lifetimeDeadline_ <= current) {
+            lifetimeDeadline_ = 0;
+            if (!timeout(EvTimeout::Kind::LIFETIME)) {
+              return;
+            }
+          }
+          if (writeTimeout_ && !writeReqs_.empty() &&
+              lastWriteAt_ + writeTimeout_ <= current) {
+            if (!timeout(EvTimeout::Kind::WRITE)) {
+              return;
+            }
+            lastWriteAt_ = current;
+          }
+          if (readTimeout_ && reading_ &&
+              lastReadAt_ + readTimeout_ <= current) {
+            if (!timeout(EvTimeout::Kind::READ)) {
+              return;
+            }
+            lastReadAt_ = current;
+          }
+          armDeadline();
+        }
+
+        struct CorkFlusher : public Loop::Deferred {
+          CorkFlusher(Stream *stream) : stream(stream) { }
+          virtual void onDeferred() override {
+            stream->flush();
+          }
+          Stream *stream;
+        };
+
+        ReqQueue<WriteReq> writeReqs_;
         std::shared_ptr<ShutdownReq> shutdownReq_;
+        std::vector<uv_buf_t> iovs_;
+        std::vector<std::unique_ptr<nul::Buffer>> corkedBuffers_;
+        CorkFlusher corkFlusher_{this};
+        bool cork_{false};
+        std::size_t corkedBytes_{0};
+        std::size_t queuedBytes_{0};
+        std::size_t highWatermark_{0};
+        std::size_t lowWatermark_{0};
+        bool writeQueueFull_{false};
+        bool allowHalfOpen_{false};
+        // the source of pauseReadingWhileFull
+        std::function<void(bool)> pauseSource_;
+        SendFileJob *sendFileJob_{nullptr};
+        ReadBufferAllocator readBufferAllocator_;
+        std::unique_ptr<nul::Buffer> ownedReadBuf_;
+        bool readBufferFromPool_{false};
+        // adaptive read buffers are on if adaptiveReadSize_ is not 0
+        std::size_t adaptiveReadSize_{0};
+        std::size_t adaptiveMinSize_{0};
+        std::size_t adaptiveMaxSize_{0};
+        int adaptiveShrinkVotes_{0};
+        ReadStats readStats_;
+        DeadlineEntry deadlineEntry_{this};
+        // when deadlineEntry_ fires, while it is scheduled
+        uint64_t deadlineAt_{0};
+        // the deadline options in ms, 0 for off
+        uint64_t connectTimeout_{0};
+        uint64_t readTimeout_{0};
+        uint64_t writeTimeout_{0};
+        // loop times (uv_now) of the running deadlines, 0 for not running
+        uint64_t connectDeadline_{0};
+        uint64_t lifetimeDeadline_{0};
+        // the read and write timeouts run from the last progress
+        uint64_t lastReadAt_{0};
+        uint64_t lastWriteAt_{0};
+        bool reading_{false};
 
+        // with UVCPP_STREAM_SHARED_READ_BUF defined, streams read into the
+        // buffer shared by all the streams of the loop instead, which saves
+        // the memory of mostly idle connections
+#ifndef UVCPP_STREAM_SHARED_READ_BUF
 #ifdef UVCPP_STREAM_BUF_SIZE
         char readBuf_[UVCPP_STREAM_BUF_SIZE];
 #else
         char readBuf_[4096];
+#endif
 #endif
     };
 
@@ -22,12 +22,21 @@ namespace uvcpp {
         INET6 = AF_INET6
       };
 
-      bool bind(SockAddr *sa) {
+      /**
+       * with reusePort, SO_REUSEPORT is set on the socket before binding,
+       * so several Tcp handles (normally one per loop) can listen on the
+       * same address and let the kernel spread incoming connections
+       */
+      bool bind(SockAddr *sa, bool reusePort = false) {
         int err = -1;
         if (sa->sa_family == AF_INET || sa->sa_family == AF_INET6) {
           //// the port starts from sa_data
           //*reinterpret_cast<uint16_t *>(sa->sa_data) = htons(port);
 
+          if (reusePort && !enableReusePort(sa->sa_family)) {
+            return false;
+          }
+
           memcpy(&sas_, sa, sa->sa_family == AF_INET ?
               sizeof(SockAddr4) : sizeof(SockAddr6));
 
@@ -42,10 +51,11 @@ namespace uvcpp {
         return err == 0;
       }
 
-      bool bind(const std::string &ip, uint16_t port) {
+      bool bind(
+        const std::string &ip, uint16_t port, bool reusePort = false) {
         SockAddrStorage sas;
         if (NetUtil::convertIPAddress(ip, port, &sas)) {
-          return bind(reinterpret_cast<SockAddr *>(&sas));
+          return bind(reinterpret_cast<SockAddr *>(&sas), reusePort);
         } else {
           LOG_E("[%s] is not a valid ip address", ip.c_str());
           return false;
@@ -69,6 +79,8 @@ namespace uvcpp {
               connectReq_->get(), get(), sa, onConnect)) != 0) {
           LOG_W("failed to connect to %s:%d, reason: %s",
                 getIP().c_str(), getPort(), uv_strerror(err));
+        } else {
+          this->startConnectDeadline();
         }
 
         return err == 0;
@@ -84,6 +96,27 @@ namespace uvcpp {
         }
       }
 
+      /**
+       * wraps an existing socket, e.g. one accepted on another loop
+       */
+      bool open(SockHandle sockHandle) {
+        int err;
+        if ((err = uv_tcp_open(get(), sockHandle)) != 0) {
+          this->reportError("uv_tcp_open", err);
+          return false;
+        }
+
+        int len = sizeof(sas_);
+        if ((err = uv_tcp_getpeername(get(),
+              reinterpret_cast<SockAddr *>(&sas_), &len)) != 0 &&
+          (err = uv_tcp_getsockname(get(),
+              reinterpret_cast<SockAddr *>(&sas_), &len)) != 0) {
+          LOG_W("uv_tcp_getsockname/uv_tcp_getpeername failed: %s",
+                uv_strerror(err));
+        }
+        return true;
+      }
+
       void setKeepAlive(bool enable) {
         int err;
         if ((err = uv_tcp_keepalive(get(), enable ? 1 : 0, 60)) != 0) {
@@ -99,15 +132,18 @@ namespace uvcpp {
       }
 
       void setSockOption(int option, void *value, socklen_t optionLength) {
+        setSockOption(SOL_SOCKET, option, value, optionLength);
+      }
+
+      void setSockOption(
+        int level, int option, void *value, socklen_t optionLength) {
         uv_os_fd_t fd;
         if (uv_fileno(reinterpret_cast<uv_handle_t *>(get()),
               &fd) == UV_EBADF) {
           LOG_W("uv_fileno failed on server_tcp");
         } else {
-          int err;
-          if ((err = setsockopt(
-                fd, SOL_SOCKET, option, value, optionLength)) == -1) {
-            this->reportError("setsockopt", err);
+          if (setsockopt(fd, level, option, value, optionLength) == -1) {
+            this->reportError("setsockopt", -errno);
           }
         }
       }
@@ -168,8 +204,37 @@ namespace uvcpp {
       }
 
     private:
+      bool enableReusePort(int family) {
+#ifdef SO_REUSEPORT
+        uv_os_fd_t fd;
+        if (uv_fileno(reinterpret_cast<uv_handle_t *>(get()), &fd) != 0) {
+          // the socket is created lazily for Domain::UNSPEC, create it here
+          // because the option must be set before bind
+          if ((fd = socket(family, SOCK_STREAM, 0)) == -1) {
+            LOG_E("socket() failed: %s", strerror(errno));
+            return false;
+          }
+          if (!open(fd)) {
+            ::close(fd);
+            return false;
+          }
+        }
+
+        int on = 1;
+        if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) == -1) {
+          LOG_E("failed to set SO_REUSEPORT: %s", strerror(errno));
+          return false;
+        }
+        return true;
+#else
+        LOG_E("SO_REUSEPORT is not supported on this platform");
+        return false;
+#endif
+      }
+
       static void onConnect(uv_connect_t *req, int status) {
         auto tcp = reinterpret_cast<Tcp *>(req->handle->data);
+        tcp->stopConnectDeadline();
         if (status < 0) {
           LOG_E("onConnect failed: %s", uv_strerror(status));
           tcp->reportError("uv_tcp_connect", status);
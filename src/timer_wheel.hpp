@@ -0,0 +1,279 @@
+/*******************************************************************************
+**          File: timer_wheel.hpp
+**        Author: neevek <i@neevek.net>.
+** Creation Time: 2026-10-24 Sat 10:20 AM
+**   Description: hierarchical timer wheel on one uv_timer_t
+*******************************************************************************/
+#ifndef UVCPP_TIMER_WHEEL_H_
+#define UVCPP_TIMER_WHEEL_H_
+#include "uv.h"
+#include <cassert>
+#include <cstdint>
+#include <cstddef>
+
+namespace uvcpp {
+
+  /**
+   * coarse timers for large numbers of timeouts that are mostly reset or
+   * cancelled before they fire (idle timeouts of connections). entries are
+   * intrusive and schedule/reset/cancel are O(1), all of them are driven by
+   * one uv_timer_t that ticks every tickMs while any entry is scheduled.
+   *
+   * 4 levels of 64 slots cover 2^24 ticks (4.6 hours with 1 ms ticks),
+   * later timeouts are parked in the last level and re-placed when reached.
+   * entries fire in the tick their timeout is reached, never earlier.
+   * not thread-safe, loop thread only
+   */
+  class TimerWheel final {
+    // checks for the close callback of the timer when the loop is destroyed
+    friend class Loop;
+
+    struct Link {
+      Link *prev{nullptr};
+      Link *next{nullptr};
+    };
+
+    static const int kLevelBits = 6;
+    static const int kLevels = 4;
+    static const uint64_t kSlots = 1 << kLevelBits;
+    static const uint64_t kSlotMask = kSlots - 1;
+    static const uint64_t kMaxTicks = (uint64_t(1) << (kLevelBits * kLevels)) - 1;
+
+    public:
+      /**
+       * subclass it and implement onTimeout, the entry is no longer
+       * scheduled when onTimeout is called, and may be scheduled again
+       * from it. it unschedules itself when destroyed
+       */
+      class Entry : private Link {
+        friend class TimerWheel;
+
+        public:
+          virtual ~Entry() {
+            if (wheel_) {
+              wheel_->cancel(this);
+            }
+          }
+
+          bool isScheduled() const {
+            return wheel_ != nullptr;
+          }
+
+        protected:
+          virtual void onTimeout() = 0;
+
+        private:
+          TimerWheel *wheel_{nullptr};
+          // the tick the entry fires in
+          uint64_t expire_{0};
+      };
+
+      TimerWheel(uv_loop_t *loop, uint64_t tickMs = 1) :
+        loop_(loop), tickMs_(tickMs ? tickMs : 1), start_(uv_now(loop)) {
+        for (auto &level : slots_) {
+          for (auto &slot : level) {
+            slot.prev = slot.next = &slot;
+          }
+        }
+        timer_ = new uv_timer_t;
+        if (uv_timer_init(loop, timer_) != 0) {
+          delete timer_;
+          timer_ = nullptr;
+          return;
+        }
+        timer_->data = this;
+      }
+
+      ~TimerWheel() {
+        for (auto &level : slots_) {
+          for (auto &slot : level) {
+            while (slot.next != &slot) {
+              auto e = static_cast<Entry *>(slot.next);
+              unlink(e);
+              e->wheel_ = nullptr;
+            }
+          }
+        }
+        // freed once libuv is done with it
+        if (timer_) {
+          uv_close(reinterpret_cast<uv_handle_t *>(timer_), onCloseCallback);
+        }
+      }
+
+      TimerWheel(const TimerWheel &) = delete;
+      TimerWheel &operator=(const TimerWheel &) = delete;
+
+      /**
+       * false if the timer of the wheel failed to initialize, nothing can
+       * be scheduled then
+       */
+      bool isValid() const {
+        return timer_ != nullptr;
+      }
+
+      /**
+       * fires e once timeoutMs from now, a scheduled entry is rescheduled
+       */
+      void schedule(Entry *e, uint64_t timeoutMs) {
+        if (!timer_) {
+          return;
+        }
+        if (e->wheel_) {
+          assert(e->wheel_ == this);
+          unlink(e);
+        } else {
+          e->wheel_ = this;
+          if (count_++ == 0) {
+            // nothing was scheduled, skip the ticks the wheel was idle
+            current_ = nowTick();
+            uv_timer_start(timer_, onTickCallback, tickMs_, tickMs_);
+          }
+        }
+
+        // rounded up, so the entry never fires early. the slot of the tick
+        // that is firing was emptied already, entries due in it go to the
+        // next one, or they would wait for a full turn of the wheel
+        auto expire = (uv_now(loop_) - start_ + timeoutMs + tickMs_ - 1) / tickMs_;
+        auto earliest = ticking_ ? current_ + 1 : current_;
+        e->expire_ = expire > earliest ? expire : earliest;
+        place(e);
+      }
+
+      void cancel(Entry *e) {
+        if (e->wheel_ != this) {
+          return;
+        }
+
+        unlink(e);
+        e->wheel_ = nullptr;
+        if (--count_ == 0) {
+          uv_timer_stop(timer_);
+        }
+      }
+
+      /**
+       * number of entries scheduled
+       */
+      std::size_t size() const {
+        return count_;
+      }
+
+      uint64_t getTickMs() const {
+        return tickMs_;
+      }
+
+    private:
+      uint64_t nowTick() const {
+        return (uv_now(loop_) - start_) / tickMs_;
+      }
+
+      static void unlink(Link *l) {
+        l->prev->next = l->next;
+        l->next->prev = l->prev;
+        l->prev = l->next = nullptr;
+      }
+
+      static void append(Link *slot, Link *l) {
+        l->prev = slot->prev;
+        l->next = slot;
+        slot->prev->next = l;
+        slot->prev = l;
+      }
+
+      void place(Entry *e) {
+        auto delta = e->expire_ - current_;
+        // entries beyond the range are parked in the last slot reachable
+        auto expire = delta > kMaxTicks ? current_ + kMaxTicks : e->expire_;
+        if (delta > kMaxTicks) {
+          delta = kMaxTicks;
+        }
+
+        auto level = 0;
+        while (delta >= (kSlots << (kLevelBits * level))) {
+          ++level;
+        }
+        auto index = (expire >> (kLevelBits * level)) & kSlotMask;
+        append(&slots_[level][index], e);
+      }
+
+      /**
+       * moves the entries of a slot to the lower levels, returns the index
+       * of the slot
+       */
+      uint64_t cascade(int level) {
+        auto index = (current_ >> (kLevelBits * level)) & kSlotMask;
+        auto &slot = slots_[level][index];
+        while (slot.next != &slot) {
+          auto e = static_cast<Entry *>(slot.next);
+          unlink(e);
+          place(e);
+        }
+        return index;
+      }
+
+      void tick() {
+        auto index = current_ & kSlotMask;
+        if (index == 0) {
+          for (auto level = 1; level < kLevels && cascade(level) == 0; ++level) {
+          }
+        }
+
+        // entries may cancel or schedule others while they fire, so the
+        // slot is detached first, a local sentinel keeps unlink working
+        Link due;
+        due.prev = due.next = &due;
+        auto &slot = slots_[0][index];
+        if (slot.next != &slot) {
+          due.next = slot.next;
+          due.prev = slot.prev;
+          due.next->prev = &due;
+          due.prev->next = &due;
+          slot.prev = slot.next = &slot;
+        }
+
+        ticking_ = true;
+        while (due.next != &due) {
+          auto e = static_cast<Entry *>(due.next);
+          unlink(e);
+          if (e->expire_ > current_) {
+            // parked beyond the range of the wheel
+            place(e);
+            continue;
+          }
+          e->wheel_ = nullptr;
+          if (--count_ == 0) {
+            uv_timer_stop(timer_);
+          }
+          e->onTimeout();
+        }
+        ticking_ = false;
+        ++current_;
+      }
+
+      static void onCloseCallback(uv_handle_t *h) {
+        delete reinterpret_cast<uv_timer_t *>(h);
+      }
+
+      static void onTickCallback(uv_timer_t *timer) {
+        auto wheel = reinterpret_cast<TimerWheel *>(timer->data);
+        auto target = wheel->nowTick();
+        while (wheel->current_ <= target && wheel->count_ > 0) {
+          wheel->tick();
+        }
+      }
+
+    private:
+      uv_loop_t *loop_;
+      uv_timer_t *timer_;
+      uint64_t tickMs_;
+      uint64_t start_;
+      // the next tick to run
+      uint64_t current_{0};
+      // in the due entries of the current_ tick
+      bool ticking_{false};
+      std::size_t count_{0};
+      Link slots_[kLevels][kSlots];
+  };
+} /* end of namspace: uvcpp */
+
+#endif /* end of include guard: UVCPP_TIMER_WHEEL_H_ */
@@ -10,20 +10,90 @@
 #include "defs.h"
 #include "util.hpp"
 #include "req.hpp"
-#include <deque>
+#include "poll.hpp"
+#include <cassert>
+#include <vector>
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/udp.h>
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+#endif
 
 namespace uvcpp {
   
   struct EvSend : public Event { };
+  struct EvSendBatch : public Event {
+    EvSendBatch(std::size_t sent) : sent(sent) { }
+
+    // datagrams handed to the kernel by one flush of Udp::sendBatch()
+    std::size_t sent;
+  };
   struct EvRecv : public Event {
     EvRecv(const char *buf, ssize_t nread, const SockAddr *addr) :
       buf(buf), nread(nread), addr(addr) { }
+    EvRecv(const char *buf, ssize_t nread, const SockAddr *addr,
+           std::unique_ptr<nul::Buffer> &&buffer) :
+      buf(buf), nread(nread), addr(addr), buffer(std::move(buffer)) { }
 
     const char *buf;
     ssize_t nread;
     const SockAddr *addr;
+    // with owned receive buffers (see Udp::setOwnedRecvBuffers), the buffer
+    // buf points into, its length is nread. listeners may std::move() it to
+    // keep the datagram without copying, otherwise it is received into again
+    mutable std::unique_ptr<nul::Buffer> buffer;
+  };
+
+  struct RecvEntry {
+    const char *buf;
+    std::size_t len;
+    const SockAddr *addr;
+    // the datagram was larger than the slot and got cut off
+    bool truncated;
   };
 
+  /**
+   * datagrams received with one syscall, the buffers and addresses are
+   * only valid during the callback
+   */
+  struct EvRecvBatch : public Event {
+    EvRecvBatch(const RecvEntry *entries, std::size_t count) :
+      entries(entries), count(count) { }
+
+    const RecvEntry *begin() const { return entries; }
+    const RecvEntry *end() const { return entries + count; }
+    std::size_t size() const { return count; }
+    const RecvEntry &operator[](std::size_t i) const { return entries[i]; }
+
+    const RecvEntry *entries;
+    std::size_t count;
+  };
+
+  // the inline receive buffer of Udp, Udp<0> has none
+  template <int N>
+  struct UdpInlineBuffer {
+    char *data() { return buf; }
+    std::size_t size() const { return N; }
+    char buf[N];
+  };
+  template <>
+  struct UdpInlineBuffer<0> {
+    char *data() { return nullptr; }
+    std::size_t size() const { return 0; }
+  };
+
+  /**
+   * PACKET_BUF is the size of the inline buffer datagrams are received
+   * into, Udp<0> has none and must receive into owned buffers
+   * (see setOwnedRecvBuffers)
+   */
   template <int PACKET_BUF = 32768>
   class Udp : public Handle<uv_udp_t, Udp<PACKET_BUF>> {
     friend class Resource<uv_udp_t, Udp<PACKET_BUF>>;
@@ -39,20 +109,56 @@ namespace uvcpp {
           return false;
         }
 
-        this->template once<EvError>([this](const auto &e, auto &udp){
-          if (!pendingReqs_.empty()) {
-            for (auto &r : pendingReqs_) {
-              this->template publish<EvBufferRecycled>(
-                EvBufferRecycled{ std::move(r->buffer) });
-            }
-            pendingReqs_.clear();
+        // sends still in flight are cancelled by libuv before EvClose,
+        // recycle the buffers of whatever is left
+        this->template once<EvClose>([this](const auto &e, auto &udp){
+          while (auto req = sendReqs_.pop()) {
+            this->recycleBuffer(std::move(req->buffer));
+            sendReqs_.release(req);
           }
+          this->getRawLoop()->cancelDeferred(&sendFlusher_);
+          for (auto &pending : pendingSends_) {
+            this->recycleBuffer(std::move(pending.buffer));
+          }
+          pendingSends_.clear();
+          // internal, EvBufferRecycled is for the buffers passed in
+          this->getRawLoop()->getBufferPool().release(
+            std::move(ownedRecvBuf_));
+#ifdef __linux__
+          closeRecvBatch();
+#endif
         });
         return true;
       }
 
+    private:
+      struct PendingSend {
+        // nullptr for the connected peer
+        const SockAddr *getAddr() const {
+          return addrLen ? reinterpret_cast<const SockAddr *>(&addr) : nullptr;
+        }
+
+        std::unique_ptr<nul::Buffer> buffer;
+        SockAddrStorage addr;
+        socklen_t addrLen;
+      };
+
+      struct SendFlusher : public Loop::Deferred {
+        SendFlusher(Udp *udp) : udp(udp) { }
+        virtual void onDeferred() override {
+          udp->flushSends();
+        }
+        Udp *udp;
+      };
+
     public:
       void recvStart() {
+        if (PACKET_BUF == 0 && !ownedRecvSize_) {
+          LOG_E("Udp<0> has no inline buffer, call setOwnedRecvBuffers first");
+          this->reportError("uv_udp_recv_start", UV_ENOBUFS);
+          return;
+        }
+
         int err;
         if ((err = uv_udp_recv_start(
               reinterpret_cast<uv_udp_t *>(this->get()),
@@ -61,6 +167,23 @@ namespace uvcpp {
         }
       }
 
+      /**
+       * receives every datagram into its own buffer from the BufferPool of
+       * the loop, of the smallest class that fits maxDatagramSize (larger
+       * datagrams are cut off), and publishes it as EvRecv::buffer.
+       * listeners that keep the buffer hand it back with send() (it is then
+       * recycled through EvBufferRecycled) or release it to the pool,
+       * buffers left in EvRecv are received into again
+       */
+      void setOwnedRecvBuffers(std::size_t maxDatagramSize = 2048) {
+        assert(maxDatagramSize > 0);
+        ownedRecvSize_ = maxDatagramSize;
+        if (ownedRecvBuf_ && ownedRecvBuf_->getCapacity() < maxDatagramSize) {
+          this->getRawLoop()->getBufferPool().release(
+            std::move(ownedRecvBuf_));
+        }
+      }
+
       void recvStop() {
         int err;
         if ((err = uv_udp_recv_stop(
@@ -69,6 +192,71 @@ namespace uvcpp {
         }
       }
 
+      /**
+       * receives datagrams as EvRecvBatch instead of EvRecv. on Linux the
+       * socket is drained with recvmmsg(2), up to batchSize datagrams of
+       * at most slotSize bytes per syscall, elsewhere the batches are of
+       * one datagram read by libuv. the handle must be bound, and
+       * recvStart() must not be used at the same time
+       */
+      bool recvBatchStart(std::size_t batchSize = 64, std::size_t slotSize = 2048) {
+#ifdef __linux__
+        assert(batchSize > 0 && slotSize > 0);
+        if (!recvBatch_ && !initRecvBatch(batchSize, slotSize)) {
+          return false;
+        }
+        recvBatch_->active = true;
+        recvBatch_->poll->poll(Poll::READABLE);
+        return true;
+#else
+        int err;
+        if ((err = uv_udp_recv_start(
+              reinterpret_cast<uv_udp_t *>(this->get()),
+              onAllocCallback, onBatchRecvCallback)) != 0) {
+          this->reportError("uv_udp_recv_start", err);
+        }
+        return err == 0;
+#endif
+      }
+
+      /**
+       * with GRO (UDP_GRO, Linux 5.0+), the kernel coalesces datagrams of
+       * a flow into one buffer, and a recvBatchStart() read returns it with
+       * its segment size. EvRecvBatch then carries the segments as separate
+       * entries that point into the coalesced buffer. slots are raised to
+       * 64 KB to take a whole coalesced buffer. must be called before
+       * recvBatchStart(), returns false if GRO isn't supported
+       */
+      bool setGro(bool gro) {
+#ifdef __linux__
+        if (recvBatch_) {
+          LOG_W("setGro must be called before recvBatchStart");
+          return false;
+        }
+        uv_os_fd_t fd;
+        int val = gro ? 1 : 0;
+        if (uv_fileno(reinterpret_cast<uv_handle_t *>(this->get()), &fd) != 0 ||
+            setsockopt(fd, SOL_UDP, UDP_GRO, &val, sizeof(val)) != 0) {
+          return false;
+        }
+        gro_ = gro;
+        return true;
+#else
+        return !gro;
+#endif
+      }
+
+      void recvBatchStop() {
+#ifdef __linux__
+        if (recvBatch_ && recvBatch_->active) {
+          recvBatch_->active = false;
+          recvBatch_->poll->stop();
+        }
+#else
+        recvStop();
+#endif
+      }
+
       bool bind(SockAddr *sa) {
         int err = -1;
         if (sa->sa_family == AF_INET || sa->sa_family == AF_INET6) {
@@ -107,33 +295,220 @@ namespace uvcpp {
 
       bool send(std::unique_ptr<nul::Buffer> &&buffer, const SockAddr *sa) {
         auto rawBuffer = buffer->asPod();
-
-        auto req = UdpSendReq::create(this->getLoop(), std::move(buffer));
-        auto rawReq = req->get();
-
-        pendingReqs_.push_back(std::move(req));
+        auto req = sendReqs_.acquire(*this);
+        req->buffer = std::move(buffer);
 
         int err;
         if ((err = uv_udp_send(
-              rawReq,
+              req->get(),
               reinterpret_cast<uv_udp_t *>(this->get()),
               reinterpret_cast<uv_buf_t *>(rawBuffer),
               1, sa, onSendCallback)) != 0) {
+          // no callback will be called for the request
+          this->recycleBuffer(std::move(req->buffer));
+          sendReqs_.release(req);
           this->reportError("uv_udp_send", err);
           return false;
         }
+        sendReqs_.push(req);
         return true;
       }
 
+      /**
+       * sends the datagram inline with uv_udp_try_send, without a request
+       * or a loop iteration, and falls back to send() only if the socket
+       * can't take it at once (EAGAIN, or sends already queued). sa is
+       * nullptr for the connected peer.
+       *
+       * the same events as send are published, but if the datagram is sent
+       * inline, EvBufferRecycled (the buffer can be taken back from it) and
+       * EvSend are published before this returns
+       */
+      bool trySend(std::unique_ptr<nul::Buffer> &&buffer, const SockAddr *sa) {
+        if (!this->isValid()) {
+          return false;
+        }
+
+        auto rawBuffer = reinterpret_cast<uv_buf_t *>(buffer->asPod());
+        auto n = uv_udp_try_send(this->get(), rawBuffer, 1, sa);
+        if (n == UV_EAGAIN || n == UV_ENOSYS) {
+          return send(std::move(buffer), sa);
+        }
+
+        this->recycleBuffer(std::move(buffer));
+        if (n < 0) {
+          this->reportError("uv_udp_try_send", n);
+          return false;
+        }
+        this->template publish<EvSend>(EvSend{});
+        return true;
+      }
+
+      /**
+       * trySend to the connected peer, or to the address set by
+       * setDesitinationAddr
+       */
+      bool trySend(std::unique_ptr<nul::Buffer> &&buffer) {
+        if (connected_) {
+          return trySend(std::move(buffer), nullptr);
+        }
+        if (!sas_) {
+          LOG_E("call connect or setDesitinationAddr to set the address first");
+          return false;
+        }
+
+        return trySend(std::move(buffer), sas_.get());
+      }
+
+      /**
+       * sends to the connected peer, or to the address set by
+       * setDesitinationAddr
+       */
       bool send(std::unique_ptr<nul::Buffer> &&buffer) {
+        if (connected_) {
+          return send(std::move(buffer), nullptr);
+        }
         if (!sas_) {
+          LOG_E("call connect or setDesitinationAddr to set the address first");
           return false;
-          LOG_E("call setDesitinationAddr to set the address first");
         }
 
         return send(std::move(buffer), sas_.get());
       }
 
+      /**
+       * associates the handle with sa (connect(2)), the kernel looks up the
+       * route once instead of for every datagram, send(buffer) and
+       * sendBatch(buffer) then pass no address, and only datagrams from sa
+       * are received. binds the handle to an ephemeral port if it isn't
+       * bound yet
+       */
+      bool connect(const SockAddr *sa) {
+        int err;
+        if ((err = uv_udp_connect(this->get(), sa)) != 0) {
+          this->reportError("uv_udp_connect", err);
+          return false;
+        }
+        connected_ = true;
+        return true;
+      }
+
+      bool connect(const std::string &ip, uint16_t port) {
+        SockAddrStorage sas;
+        if (NetUtil::convertIPAddress(ip, port, &sas)) {
+          return connect(reinterpret_cast<SockAddr *>(&sas));
+        } else {
+          LOG_E("[%s] is not a valid ip address", ip.c_str());
+          return false;
+        }
+      }
+
+      /**
+       * dissolves the association made by connect
+       */
+      bool disconnect() {
+        if (!connected_) {
+          return true;
+        }
+        int err;
+        if ((err = uv_udp_connect(this->get(), nullptr)) != 0) {
+          this->reportError("uv_udp_connect", err);
+          return false;
+        }
+        connected_ = false;
+        return true;
+      }
+
+      bool isConnected() const {
+        return connected_;
+      }
+
+      /**
+       * queues the datagram, the queue is flushed at the end of the current
+       * loop iteration or by flushSends(). on Linux it is flushed with
+       * sendmmsg(2) and EvSendBatch is published for the datagrams sent,
+       * whatever the socket can't take at once goes through send() and
+       * completes with EvSend, elsewhere all of them go through send()
+       */
+      void sendBatch(std::unique_ptr<nul::Buffer> &&buffer, const SockAddr *sa) {
+        pendingSends_.push_back(PendingSend{});
+        auto &pending = pendingSends_.back();
+        pending.buffer = std::move(buffer);
+        pending.addrLen = sa->sa_family == AF_INET6 ?
+          sizeof(SockAddr6) : sizeof(SockAddr4);
+        memcpy(&pending.addr, sa, pending.addrLen);
+        this->getRawLoop()->defer(&sendFlusher_);
+      }
+
+      /**
+       * sendBatch to the connected peer
+       */
+      void sendBatch(std::unique_ptr<nul::Buffer> &&buffer) {
+        if (!connected_) {
+          LOG_E("sendBatch without an address requires connect");
+          this->recycleBuffer(std::move(buffer));
+          return;
+        }
+        pendingSends_.push_back(PendingSend{});
+        auto &pending = pendingSends_.back();
+        pending.buffer = std::move(buffer);
+        pending.addrLen = 0;
+        this->getRawLoop()->defer(&sendFlusher_);
+      }
+
+      void flushSends() {
+        this->getRawLoop()->cancelDeferred(&sendFlusher_);
+        // datagrams queued after the handle is closing are recycled on EvClose
+        if (pendingSends_.empty() || !this->isValid()) {
+          return;
+        }
+
+        std::vector<PendingSend> sends;
+        sends.swap(pendingSends_);
+        std::size_t sent = 0;
+#ifdef __linux__
+        auto i = flushWithSendmmsg(sends, &sent);
+#else
+        std::size_t i = 0;
+#endif
+        for (; i < sends.size(); ++i) {
+          send(std::move(sends[i].buffer), sends[i].getAddr());
+        }
+
+        // keep the capacity
+        sends.clear();
+        if (pendingSends_.empty()) {
+          pendingSends_.swap(sends);
+        }
+        if (sent > 0) {
+          this->template publish<EvSendBatch>(EvSendBatch{ sent });
+        }
+      }
+
+      /**
+       * with GSO (UDP_SEGMENT, Linux 4.18+), sendBatch() passes runs of
+       * datagrams of the same size to the same destination to the kernel as
+       * one buffer, which it segments, returns false if it isn't supported.
+       * the handle must be bound
+       */
+      bool setGso(bool gso) {
+#ifdef __linux__
+        if (!gso) {
+          gso_ = false;
+          return true;
+        }
+        uv_os_fd_t fd;
+        int val;
+        socklen_t len = sizeof(val);
+        gso_ = uv_fileno(
+            reinterpret_cast<uv_handle_t *>(this->get()), &fd) == 0 &&
+          getsockopt(fd, SOL_UDP, UDP_SEGMENT, &val, &len) == 0;
+        return gso_;
+#else
+        return !gso;
+#endif
+      }
+
       void setDesitinationAddr(const std::string &ip, uint16_t port) {
         SockAddrStorage sas;
         if (NetUtil::convertIPAddress(ip, port, &sas)) {
@@ -152,10 +527,10 @@ namespace uvcpp {
       void setDesitinationAddr(SockAddrStorage *addr) {
         auto p = sas_.get();
         if (!p) {
-          p = reinterpret_cast<SockAddr *>(malloc(sizeof(addr)));
+          p = reinterpret_cast<SockAddr *>(malloc(sizeof(SockAddrStorage)));
           sas_.reset(p);
         }
-        memcpy(p, &addr, sizeof(addr));
+        memcpy(p, addr, sizeof(SockAddrStorage));
       }
 
       std::string getIP() {
@@ -174,7 +549,7 @@ namespace uvcpp {
       void fillLocalSockAddrIfNeeded() {
         if (!localSa_) {
           SockAddrStorage sas;
-          int len;
+          int len = sizeof(sas);
           if (uv_udp_getsockname(
               reinterpret_cast<uv_udp_t *>(this->get()),
               reinterpret_cast<SockAddr *>(&sas), &len) == 0) {
@@ -191,8 +566,17 @@ namespace uvcpp {
       static void onAllocCallback(
           uv_handle_t *handle, std::size_t size, uv_buf_t *buf) {
         auto udp = reinterpret_cast<Udp *>(handle->data);
-        buf->base = udp->recvBuf_;
-        buf->len = sizeof(udp->recvBuf_);
+        if (udp->ownedRecvSize_) {
+          auto &owned = udp->ownedRecvBuf_;
+          if (!owned) {
+            owned = udp->getRawLoop()->getBufferPool().acquire(
+              udp->ownedRecvSize_);
+          }
+          *buf = uv_buf_init(owned->getData(), owned->getCapacity());
+        } else {
+          // empty for Udp<0>, which fails the read with UV_ENOBUFS
+          *buf = uv_buf_init(udp->recvBuf_.data(), udp->recvBuf_.size());
+        }
       }
 
       static void onRecvCallback(
@@ -211,18 +595,311 @@ namespace uvcpp {
         }
 
         // nread may be 0 for empty packet
+        auto &owned = udp->ownedRecvBuf_;
+        if (owned && buf->base == owned->getData()) {
+          owned->setLength(nread);
+          EvRecv event{ buf->base, nread, addr, std::move(owned) };
+          udp->template publish<EvRecv>(std::move(event));
+          if (event.buffer && !owned) {
+            // unless setOwnedRecvBuffers asked for larger ones meanwhile
+            if (event.buffer->getCapacity() >= udp->ownedRecvSize_) {
+              owned = std::move(event.buffer);
+            } else {
+              udp->getRawLoop()->getBufferPool().release(
+                std::move(event.buffer));
+            }
+          }
+          return;
+        }
+
         udp->template publish<EvRecv>(EvRecv{ buf->base, nread, addr });
       }
 
-      static void onSendCallback(uv_udp_send_t *req, int status) {
-        auto udp = reinterpret_cast<Udp *>(req->handle->data);
-        if (!udp->pendingReqs_.empty()) {
-          auto req = std::move(udp->pendingReqs_.front());
-          udp->pendingReqs_.pop_front();
+#ifdef __linux__
+      struct RecvBatch {
+        int fd{-1};
+        bool active{false};
+        std::shared_ptr<Poll> poll;
+        std::unique_ptr<char[]> slots;
+        std::vector<mmsghdr> msgs;
+        std::vector<iovec> iovs;
+        std::vector<SockAddrStorage> addrs;
+        std::vector<RecvEntry> entries;
+        // with GRO, the segment size of each message comes as a cmsg
+        bool gro{false};
+        std::unique_ptr<char[]> controls;
+      };
+
+      static const std::size_t kGroControlSize = CMSG_SPACE(sizeof(int));
+
+      bool initRecvBatch(std::size_t batchSize, std::size_t slotSize) {
+        uv_os_fd_t rawFd;
+        int err;
+        if ((err = uv_fileno(
+              reinterpret_cast<uv_handle_t *>(this->get()), &rawFd)) != 0) {
+          this->reportError("uv_fileno", err);
+          return false;
+        }
+
+        auto b = std::make_unique<RecvBatch>();
+        // epoll can watch a duplicate while libuv owns the original
+        if ((b->fd = fcntl(rawFd, F_DUPFD_CLOEXEC, 0)) == -1) {
+          this->reportError("dup", -errno);
+          return false;
+        }
+        b->poll = Poll::create(this->getLoop());
+        if (!b->poll || !b->poll->initWithSockHandle(b->fd)) {
+          ::close(b->fd);
+          return false;
+        }
+        b->poll->template on<EvPoll>([this](const auto &e, auto &poll) {
+          recvBatches();
+        });
+        b->poll->template on<EvError>([this](const auto &e, auto &poll) {
+          this->reportError("poll", e.status);
+        });
+
+        b->gro = gro_;
+        if (gro_) {
+          if (slotSize < kGroSlotSize) {
+            slotSize = kGroSlotSize;
+          }
+          b->controls.reset(new char[batchSize * kGroControlSize]);
+        }
+        b->slots.reset(new char[batchSize * slotSize]);
+        b->msgs.resize(batchSize);
+        b->iovs.resize(batchSize);
+        b->addrs.resize(batchSize);
+        b->entries.reserve(batchSize);
+        for (std::size_t i = 0; i < batchSize; ++i) {
+          b->iovs[i].iov_base = b->slots.get() + i * slotSize;
+          b->iovs[i].iov_len = slotSize;
+          auto &hdr = b->msgs[i].msg_hdr;
+          memset(&hdr, 0, sizeof(hdr));
+          hdr.msg_iov = &b->iovs[i];
+          hdr.msg_iovlen = 1;
+          hdr.msg_name = &b->addrs[i];
+        }
+        recvBatch_ = std::move(b);
+        return true;
+      }
+
+      void recvBatches() {
+        auto b = recvBatch_.get();
+        // bounded, so that a flood does not starve the rest of the loop
+        for (int round = 0; round < kMaxRecvBatchRounds; ++round) {
+          if (!b->active || !this->isValid()) {
+            return;
+          }
+          for (std::size_t i = 0; i < b->msgs.size(); ++i) {
+            auto &hdr = b->msgs[i].msg_hdr;
+            hdr.msg_namelen = sizeof(SockAddrStorage);
+            if (b->gro) {
+              hdr.msg_control = b->controls.get() + i * kGroControlSize;
+              hdr.msg_controllen = kGroControlSize;
+            }
+          }
+
+          int n;
+          do {
+            n = ::recvmmsg(b->fd, b->msgs.data(), b->msgs.size(),
+                           MSG_DONTWAIT, nullptr);
+          } while (n == -1 && errno == EINTR);
+          if (n == -1) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+              this->reportError("recvmmsg", -errno);
+            }
+            return;
+          }
 
-          udp->template publish<EvBufferRecycled>(
-            EvBufferRecycled{ std::move(req->buffer) });
+          b->entries.clear();
+          for (int i = 0; i < n; ++i) {
+            addRecvEntries(b, i);
+          }
+          this->template publish<EvRecvBatch>(
+            EvRecvBatch{ b->entries.data(), b->entries.size() });
+
+          if (static_cast<std::size_t>(n) < b->msgs.size()) {
+            return;
+          }
         }
+      }
+
+      /**
+       * one entry per datagram, or per segment of a coalesced GRO buffer
+       */
+      static void addRecvEntries(RecvBatch *b, int i) {
+        auto &hdr = b->msgs[i].msg_hdr;
+        auto data = reinterpret_cast<const char *>(b->iovs[i].iov_base);
+        std::size_t len = b->msgs[i].msg_len;
+        auto addr = reinterpret_cast<const SockAddr *>(&b->addrs[i]);
+        auto truncated = (hdr.msg_flags & MSG_TRUNC) != 0;
+
+        std::size_t segmentSize = 0;
+        if (b->gro) {
+          for (auto cm = CMSG_FIRSTHDR(&hdr); cm; cm = CMSG_NXTHDR(&hdr, cm)) {
+            if (cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO) {
+              int size;
+              memcpy(&size, CMSG_DATA(cm), sizeof(size));
+              segmentSize = size;
+            }
+          }
+        }
+        if (segmentSize == 0 || segmentSize > len) {
+          b->entries.push_back(RecvEntry{ data, len, addr, truncated });
+          return;
+        }
+
+        for (std::size_t off = 0; off < len; off += segmentSize) {
+          auto segmentLen = len - off < segmentSize ? len - off : segmentSize;
+          b->entries.push_back(RecvEntry{
+            data + off, segmentLen, addr,
+            truncated && off + segmentLen == len });
+        }
+      }
+
+      void closeRecvBatch() {
+        if (recvBatch_) {
+          // the fd must not be closed before the poll handle stops
+          recvBatch_->poll->template selfRefUntil<EvClose>();
+          recvBatch_->poll->close();
+          ::close(recvBatch_->fd);
+          recvBatch_.reset();
+        }
+      }
+
+      /**
+       * returns the index of the first datagram not sent
+       */
+      std::size_t flushWithSendmmsg(
+        std::vector<PendingSend> &sends, std::size_t *sent) {
+        uv_os_fd_t fd;
+        if (uv_fileno(reinterpret_cast<uv_handle_t *>(this->get()), &fd) != 0) {
+          return 0;
+        }
+
+        if (!sendScratch_) {
+          sendScratch_ = std::make_unique<SendScratch>();
+        }
+        auto &scratch = *sendScratch_;
+        if (sendIovs_.size() < sends.size()) {
+          sendIovs_.resize(sends.size());
+        }
+        for (std::size_t k = 0; k < sends.size(); ++k) {
+          sendIovs_[k].iov_base = sends[k].buffer->getData();
+          sendIovs_[k].iov_len = sends[k].buffer->getLength();
+        }
+
+        std::size_t i = 0;
+        // once the kernel refuses a GSO run, the rest of the batch is sent
+        // as single datagrams
+        auto noGso = false;
+        while (i < sends.size()) {
+          std::size_t count = 0;
+          for (auto k = i; k < sends.size() && count < kMaxSendBatch; ++count) {
+            auto end = noGso ? k + 1 : gsoRunEnd(sends, k);
+            auto &hdr = scratch.msgs[count].msg_hdr;
+            memset(&hdr, 0, sizeof(hdr));
+            hdr.msg_name = const_cast<SockAddr *>(sends[k].getAddr());
+            hdr.msg_namelen = sends[k].addrLen;
+            hdr.msg_iov = &sendIovs_[k];
+            hdr.msg_iovlen = end - k;
+            if (end - k > 1) {
+              hdr.msg_control = scratch.controls[count];
+              hdr.msg_controllen = sizeof(scratch.controls[count]);
+              auto cm = CMSG_FIRSTHDR(&hdr);
+              cm->cmsg_level = SOL_UDP;
+              cm->cmsg_type = UDP_SEGMENT;
+              cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+              uint16_t segmentSize = sendIovs_[k].iov_len;
+              memcpy(CMSG_DATA(cm), &segmentSize, sizeof(segmentSize));
+            }
+            scratch.runEnds[count] = end;
+            k = end;
+          }
+
+          int n;
+          do {
+            n = ::sendmmsg(fd, scratch.msgs, count, MSG_DONTWAIT);
+          } while (n == -1 && errno == EINTR);
+
+          if (n > 0) {
+            auto end = scratch.runEnds[n - 1];
+            *sent += end - i;
+            for (; i < end; ++i) {
+              this->recycleBuffer(std::move(sends[i].buffer));
+            }
+            continue;
+          }
+          if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+            break;
+          }
+          if (scratch.runEnds[0] - i > 1) {
+            noGso = true;
+            continue;
+          }
+          // the datagram itself is rejected, EMSGSIZE for example
+          this->reportError("sendmmsg", -errno);
+          this->recycleBuffer(std::move(sends[i].buffer));
+          ++i;
+        }
+        return i;
+      }
+
+      std::size_t gsoRunEnd(const std::vector<PendingSend> &sends, std::size_t k) {
+        auto segmentSize = sends[k].buffer->getLength();
+        auto end = k + 1;
+        if (!gso_ || segmentSize == 0) {
+          return end;
+        }
+        auto total = segmentSize;
+        while (end < sends.size() && end - k < kMaxGsoSegments) {
+          auto &next = sends[end];
+          auto len = next.buffer->getLength();
+          if (len == 0 || len > segmentSize || total + len > kMaxGsoBytes ||
+              next.addrLen != sends[k].addrLen ||
+              memcmp(&next.addr, &sends[k].addr, next.addrLen) != 0) {
+            break;
+          }
+          total += len;
+          ++end;
+          // only the last segment may be shorter
+          if (len < segmentSize) {
+            break;
+          }
+        }
+        return end;
+      }
+#else
+      static void onBatchRecvCallback(
+          uv_udp_t *handle, ssize_t nread, const uv_buf_t *buf,
+          const SockAddr* addr, unsigned int flags) {
+        if (nread == 0 && !addr) {
+          return;
+        }
+
+        auto udp = reinterpret_cast<Udp *>(handle->data);
+        if (nread < 0) {
+          LOG_E("UDP read failed: %s", uv_strerror(nread));
+          udp->close();
+          return;
+        }
+
+        RecvEntry entry{
+          buf->base, static_cast<std::size_t>(nread), addr,
+          (flags & UV_UDP_PARTIAL) != 0
+        };
+        udp->template publish<EvRecvBatch>(EvRecvBatch{ &entry, 1 });
+      }
+#endif
+
+      static void onSendCallback(uv_udp_send_t *rawReq, int status) {
+        auto udp = reinterpret_cast<Udp *>(rawReq->handle->data);
+        // udp sends complete in the order they are submitted
+        auto req = udp->sendReqs_.pop();
+        assert(req && req->get() == rawReq);
+        udp->recycleBuffer(std::move(req->buffer));
+        udp->sendReqs_.release(req);
 
         if (status < 0) {
           udp->reportError("send", status);
@@ -232,10 +909,36 @@ namespace uvcpp {
       }
 
     private:
-      std::deque<std::shared_ptr<UdpSendReq>> pendingReqs_{};
+      ReqQueue<UdpSendReq> sendReqs_;
+      std::vector<PendingSend> pendingSends_;
+      SendFlusher sendFlusher_{this};
       std::unique_ptr<SockAddr, CPointerDeleterType> localSa_{nullptr, CPointerDeleter};
       std::unique_ptr<SockAddr, CPointerDeleterType> sas_{nullptr, CPointerDeleter};
-      char recvBuf_[PACKET_BUF];
+      bool connected_{false};
+      UdpInlineBuffer<PACKET_BUF> recvBuf_;
+      // owned receive buffers are on if ownedRecvSize_ is not 0
+      std::size_t ownedRecvSize_{0};
+      std::unique_ptr<nul::Buffer> ownedRecvBuf_;
+#ifdef __linux__
+      static const int kMaxRecvBatchRounds = 16;
+      static const std::size_t kMaxSendBatch = 64;
+      // UDP_MAX_SEGMENTS of the kernel, and what fits in one UDP datagram
+      static const std::size_t kMaxGsoSegments = 64;
+      static const std::size_t kMaxGsoBytes = 65507;
+      // the largest buffer GRO coalesces into
+      static const std::size_t kGroSlotSize = 65535;
+      std::unique_ptr<RecvBatch> recvBatch_;
+      bool gso_{false};
+      bool gro_{false};
+      std::vector<iovec> sendIovs_;
+      // sendmmsg scratch, allocated by the first flush of sendBatch
+      struct SendScratch {
+        mmsghdr msgs[kMaxSendBatch];
+        char controls[kMaxSendBatch][CMSG_SPACE(sizeof(uint16_t))];
+        std::size_t runEnds[kMaxSendBatch];
+      };
+      std::unique_ptr<SendScratch> sendScratch_;
+#endif
   };
 
 } /* end of namspace: uvcpp */
@@ -13,9 +13,14 @@
 #include "udp.hpp"
 #include "pipe.hpp"
 #include "timer.hpp"
+#include "timer_wheel.hpp"
 #include "prepare.hpp"
+#include "async.hpp"
 #include "poll.hpp"
 #include "fs_event.hpp"
+#include "relay.hpp"
+#include "loop_group.hpp"
+#include "work_executor.hpp"
 #include "ext/poll_unix_sock.hpp"
 
 #endif /* end of include guard: UVCPP_H_ */
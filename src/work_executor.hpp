@@ -0,0 +1,620 @@
+/*******************************************************************************
+**          File: work_executor.hpp
+**        Author: neevek <i@neevek.net>.
+** Creation Time: 2026-10-25 Sun 03:40 PM
+**   Description: runs jobs returning values on a dedicated thread pool
+*******************************************************************************/
+#ifndef UVCPP_WORK_EXECUTOR_H_
+#define UVCPP_WORK_EXECUTOR_H_
+#include "async.hpp"
+#include "mpsc_queue.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace uvcpp {
+
+  class WorkExecutor;
+
+  /**
+   * what a job of WorkExecutor returned, or threw
+   */
+  template <typename T>
+  class WorkResult {
+    friend class WorkExecutor;
+
+    public:
+      WorkResult() = default;
+
+      WorkResult(WorkResult &&other) :
+        status_(other.status_), exception_(std::move(other.exception_)) {
+        if (other.hasValue_) {
+          new (&storage_) T(std::move(*other.ptr()));
+          hasValue_ = true;
+        }
+      }
+
+      WorkResult(const WorkResult &) = delete;
+      WorkResult &operator=(const WorkResult &) = delete;
+
+      ~WorkResult() {
+        if (hasValue_) {
+          ptr()->~T();
+        }
+      }
+
+      /**
+       * 0, or UV_ECANCELED if the executor was shut down before the job ran
+       */
+      int status() const {
+        return status_;
+      }
+
+      bool ok() const {
+        return status_ == 0 && !exception_;
+      }
+
+      std::exception_ptr getException() const {
+        return exception_;
+      }
+
+      /**
+       * the value returned by the job, the exception it threw is rethrown,
+       * status() must be 0
+       */
+      T &get() {
+        assert(status_ == 0);
+        if (exception_) {
+          std::rethrow_exception(exception_);
+        }
+        return *ptr();
+      }
+
+    private:
+      template <typename F>
+      void run(F &fn) {
+        try {
+          new (&storage_) T(fn());
+          hasValue_ = true;
+        } catch (...) {
+          exception_ = std::current_exception();
+        }
+      }
+
+      T *ptr() {
+        return reinterpret_cast<T *>(&storage_);
+      }
+
+    private:
+      int status_{0};
+      std::exception_ptr exception_;
+      std::aligned_storage_t<sizeof(T), alignof(T)> storage_;
+      bool hasValue_{false};
+  };
+
+  template <>
+  class WorkResult<void> {
+    friend class WorkExecutor;
+
+    public:
+      int status() const {
+        return status_;
+      }
+
+      bool ok() const {
+        return status_ == 0 && !exception_;
+      }
+
+      std::exception_ptr getException() const {
+        return exception_;
+      }
+
+      void get() {
+        assert(status_ == 0);
+        if (exception_) {
+          std::rethrow_exception(exception_);
+        }
+      }
+
+    private:
+      template <typename F>
+      void run(F &fn) {
+        try {
+          fn();
+        } catch (...) {
+          exception_ = std::current_exception();
+        }
+      }
+
+    private:
+      int status_{0};
+      std::exception_ptr exception_;
+  };
+
+  /**
+   * runs jobs on threads of its own instead of the libuv threadpool, so
+   * CPU heavy jobs don't hold up getaddrinfo and fs requests (which share
+   * the 4 threads of uv_queue_work by default), and hands what they return
+   * back on the loop thread. the loop is kept alive while jobs are running.
+   *
+   * every thread has a queue of its own, jobs are spread over them and a
+   * thread that runs out of jobs steals from the others, so many small
+   * jobs don't all contend on one lock as they do with uv_queue_work.
+   *
+   * start, submit and shutdown are called on the loop thread
+   */
+  class WorkExecutor final {
+    struct Job {
+      virtual ~Job() = default;
+      // on a pool thread
+      virtual void run() = 0;
+      // instead of run, on the loop thread
+      virtual void cancel() = 0;
+      // after run or cancel, the job to complete on the loop thread, if any
+      virtual Job *finish() = 0;
+      // on the loop thread, the job is deleted afterwards
+      virtual void complete() = 0;
+    };
+
+    template <typename F, typename C>
+    struct SingleJob : public Job {
+      using R = std::result_of_t<F &()>;
+
+      template <typename FF, typename CC>
+      SingleJob(FF &&fn, CC &&done) :
+        fn(std::forward<FF>(fn)), done(std::forward<CC>(done)) { }
+
+      virtual void run() override {
+        result.run(fn);
+      }
+      virtual void cancel() override {
+        result.status_ = UV_ECANCELED;
+      }
+      virtual Job *finish() override {
+        return this;
+      }
+      virtual void complete() override {
+        done(result);
+      }
+
+      F fn;
+      C done;
+      WorkResult<R> result;
+    };
+
+    template <typename F, typename C>
+    struct BatchJob : public Job {
+      using R = std::result_of_t<F &()>;
+
+      // the jobs of a batch live in it, they are queued one by one
+      struct Part : public Job {
+        virtual void run() override {
+          batch->results[index].run(batch->fns[index]);
+        }
+        virtual void cancel() override {
+          batch->results[index].status_ = UV_ECANCELED;
+        }
+        virtual Job *finish() override {
+          return batch->remaining.fetch_sub(1) == 1 ? batch : nullptr;
+        }
+        virtual void complete() override { }
+
+        BatchJob *batch;
+        std::size_t index;
+      };
+
+      template <typename CC>
+      BatchJob(std::vector<F> &&fns, CC &&done) :
+        fns(std::move(fns)), results(this->fns.size()),
+        parts(this->fns.size()), remaining(this->fns.size()),
+        done(std::forward<CC>(done)) {
+        for (std::size_t i = 0; i < parts.size(); ++i) {
+          parts[i].batch = this;
+          parts[i].index = i;
+        }
+      }
+
+      virtual void run() override { }
+      virtual void cancel() override { }
+      virtual Job *finish() override {
+        return this;
+      }
+      virtual void complete() override {
+        done(results);
+      }
+
+      std::vector<F> fns;
+      std::vector<WorkResult<R>> results;
+      std::vector<Part> parts;
+      std::atomic<std::size_t> remaining;
+      C done;
+    };
+
+    template <typename F, typename C>
+    struct RangeJob : public Job {
+      // a chunk of the range
+      struct Part : public Job {
+        virtual void run() override {
+          if (batch->failed) {
+            return;
+          }
+          try {
+            for (auto i = begin; i < end; ++i) {
+              batch->fn(i);
+            }
+          } catch (...) {
+            if (!batch->failed.exchange(true)) {
+              batch->result.exception_ = std::current_exception();
+            }
+          }
+        }
+        virtual void cancel() override {
+          batch->result.status_ = UV_ECANCELED;
+        }
+        virtual Job *finish() override {
+          return batch->remaining.fetch_sub(1) == 1 ? batch : nullptr;
+        }
+        virtual void complete() override { }
+
+        RangeJob *batch;
+        std::size_t begin;
+        std::size_t end;
+      };
+
+      template <typename FF, typename CC>
+      RangeJob(std::size_t begin, std::size_t end, std::size_t grain,
+               FF &&fn, CC &&done) :
+        fn(std::forward<FF>(fn)), done(std::forward<CC>(done)),
+        parts((end - begin + grain - 1) / grain), remaining(parts.size()) {
+        for (auto &part : parts) {
+          part.batch = this;
+          part.begin = begin;
+          part.end = end - begin > grain ? begin + grain : end;
+          begin = part.end;
+        }
+      }
+
+      virtual void run() override { }
+      virtual void cancel() override { }
+      virtual Job *finish() override {
+        return this;
+      }
+      virtual void complete() override {
+        done(result);
+      }
+
+      F fn;
+      C done;
+      WorkResult<void> result;
+      std::vector<Part> parts;
+      std::atomic<std::size_t> remaining;
+      std::atomic<bool> failed{false};
+    };
+
+    struct Worker {
+      std::mutex mutex;
+      // the owner takes from the front, thieves from the back
+      std::deque<Job *> jobs;
+      std::thread thread;
+    };
+
+    public:
+      /**
+       * threads == 0 means one thread per hardware thread
+       */
+      WorkExecutor(const std::shared_ptr<Loop> &loop, std::size_t threads = 0) :
+        loop_(loop), threadCount_(threads) {
+        if (threadCount_ == 0) {
+          threadCount_ = std::max(1u, std::thread::hardware_concurrency());
+        }
+      }
+
+      ~WorkExecutor() {
+        shutdown();
+      }
+
+      WorkExecutor(const WorkExecutor &) = delete;
+      WorkExecutor &operator=(const WorkExecutor &) = delete;
+
+      bool start() {
+        if (async_) {
+          LOG_W("WorkExecutor already started");
+          return false;
+        }
+
+        async_ = Async::create(loop_);
+        if (!async_) {
+          return false;
+        }
+        async_->on<EvAsync>([this](const auto &e, auto &async) {
+          drainCompleted();
+        });
+        // only jobs in flight keep the loop alive
+        uv_unref(reinterpret_cast<uv_handle_t *>(async_->get()));
+
+        for (std::size_t i = 0; i < threadCount_; ++i) {
+          workers_.emplace_back(std::make_unique<Worker>());
+        }
+        for (std::size_t i = 0; i < threadCount_; ++i) {
+          workers_[i]->thread = std::thread([this, i]{ runJobs(i); });
+        }
+        return true;
+      }
+
+      /**
+       * runs fn() on a pool thread, and then done(WorkResult<R> &) on the
+       * loop thread, R is what fn returns
+       */
+      template <typename F, typename C>
+      bool submit(F &&fn, C &&done) {
+        using Single = SingleJob<std::decay_t<F>, std::decay_t<C>>;
+        if (!async_ || stopping_) {
+          return false;
+        }
+
+        auto job = new Single(std::forward<F>(fn), std::forward<C>(done));
+        addInFlight();
+        enqueue(job);
+        return true;
+      }
+
+      /**
+       * runs the jobs on the pool threads in parallel, and then calls
+       * done(std::vector<WorkResult<R>> &) once on the loop thread with
+       * the results in the order of the jobs
+       */
+      template <typename F, typename C>
+      bool submitBatch(std::vector<F> &&fns, C &&done) {
+        using Batch = BatchJob<F, std::decay_t<C>>;
+        if (!async_ || stopping_) {
+          return false;
+        }
+
+        auto batch = new Batch(std::move(fns), std::forward<C>(done));
+        addInFlight();
+        if (batch->parts.empty()) {
+          pushCompleted(batch);
+          return true;
+        }
+
+        enqueueParts(batch->parts);
+        return true;
+      }
+
+      /**
+       * runs fn(i) for every i in [begin, end) on the pool threads, in
+       * chunks of grain indexes (0 makes about 4 chunks per thread), and
+       * then done(WorkResult<void> &) once on the loop thread, it holds the
+       * first exception thrown, chunks not started after that are skipped
+       */
+      template <typename F, typename C>
+      bool parallelFor(std::size_t begin, std::size_t end, std::size_t grain,
+                       F &&fn, C &&done) {
+        using Range = RangeJob<std::decay_t<F>, std::decay_t<C>>;
+        if (!async_ || stopping_) {
+          return false;
+        }
+
+        if (end < begin) {
+          end = begin;
+        }
+        if (grain == 0) {
+          grain = std::max<std::size_t>(
+            1, (end - begin + threadCount_ * 4 - 1) / (threadCount_ * 4));
+        }
+
+        auto range = new Range(
+          begin, end, grain, std::forward<F>(fn), std::forward<C>(done));
+        addInFlight();
+        if (range->parts.empty()) {
+          pushCompleted(range);
+          return true;
+        }
+        enqueueParts(range->parts);
+        return true;
+      }
+
+      /**
+       * the jobs not started yet are completed with UV_ECANCELED right
+       * away, then it blocks until the running ones finish and completes
+       * them, and stops the threads. the loop has to run once more to
+       * finish closing the Async of the executor
+       */
+      void shutdown() {
+        if (!async_ || stopping_) {
+          return;
+        }
+
+        {
+          std::lock_guard<std::mutex> lock(sleepMutex_);
+          stopping_ = true;
+        }
+        cond_.notify_all();
+
+        for (auto &w : workers_) {
+          std::deque<Job *> cancelled;
+          {
+            std::lock_guard<std::mutex> lock(w->mutex);
+            cancelled.swap(w->jobs);
+          }
+          for (auto job : cancelled) {
+            job->cancel();
+            if (auto done = job->finish()) {
+              completeJob(done);
+            }
+          }
+        }
+        for (auto &w : workers_) {
+          w->thread.join();
+        }
+        workers_.clear();
+        drainCompleted();
+
+        async_->selfRefUntil<EvClose>();
+        async_->close();
+      }
+
+      /**
+       * submitted and not completed yet, batches count as one
+       */
+      std::size_t getInFlight() const {
+        return inFlight_;
+      }
+
+      std::size_t getThreadCount() const {
+        return threadCount_;
+      }
+
+    private:
+      void enqueue(Job *job) {
+        auto &w = *workers_[next_++ % workers_.size()];
+        ++queued_;
+        {
+          std::lock_guard<std::mutex> lock(w.mutex);
+          w.jobs.push_back(job);
+        }
+        wake(false);
+      }
+
+      /**
+       * spreads the parts in contiguous runs over the threads
+       */
+      template <typename Part>
+      void enqueueParts(std::vector<Part> &parts) {
+        auto n = workers_.size();
+        auto per = (parts.size() + n - 1) / n;
+        queued_ += parts.size();
+        for (std::size_t i = 0, w = next_++; i < parts.size(); i += per, ++w) {
+          auto &worker = *workers_[w % n];
+          std::lock_guard<std::mutex> lock(worker.mutex);
+          for (auto j = i; j < i + per && j < parts.size(); ++j) {
+            worker.jobs.push_back(&parts[j]);
+          }
+        }
+        wake(parts.size() > 1);
+      }
+
+      void wake(bool all) {
+        // pairs with the check of queued_ after sleeping_ is raised
+        if (sleeping_ == 0) {
+          return;
+        }
+        {
+          std::lock_guard<std::mutex> lock(sleepMutex_);
+        }
+        if (all) {
+          cond_.notify_all();
+        } else {
+          cond_.notify_one();
+        }
+      }
+
+      Job *take(std::size_t index) {
+        {
+          auto &w = *workers_[index];
+          std::lock_guard<std::mutex> lock(w.mutex);
+          if (!w.jobs.empty()) {
+            auto job = w.jobs.front();
+            w.jobs.pop_front();
+            return job;
+          }
+        }
+
+        auto n = workers_.size();
+        for (std::size_t i = 1; i < n; ++i) {
+          auto &w = *workers_[(index + i) % n];
+          std::lock_guard<std::mutex> lock(w.mutex);
+          if (!w.jobs.empty()) {
+            auto job = w.jobs.back();
+            w.jobs.pop_back();
+            return job;
+          }
+        }
+        return nullptr;
+      }
+
+      void runJobs(std::size_t index) {
+        const auto IDLE_YIELDS = 4;
+        auto idle = 0;
+        while (true) {
+          if (auto job = take(index)) {
+            idle = 0;
+            --queued_;
+            job->run();
+            if (auto done = job->finish()) {
+              pushCompleted(done);
+            }
+            continue;
+          }
+
+          // the next jobs are usually submitted from the completions of the
+          // last ones, yielding a few times picks them up without a sleep
+          if (++idle < IDLE_YIELDS) {
+            std::this_thread::yield();
+            continue;
+          }
+          idle = 0;
+
+          std::unique_lock<std::mutex> lock(sleepMutex_);
+          if (stopping_) {
+            return;
+          }
+          ++sleeping_;
+          cond_.wait(lock, [this]{ return stopping_ || queued_ > 0; });
+          --sleeping_;
+        }
+      }
+
+      void pushCompleted(Job *job) {
+        completed_.push(std::move(job));
+        async_->send();
+      }
+
+      void drainCompleted() {
+        Job *job;
+        while (completed_.pop(job)) {
+          completeJob(job);
+        }
+      }
+
+      void completeJob(Job *job) {
+        job->complete();
+        delete job;
+        if (--inFlight_ == 0 && async_) {
+          uv_unref(reinterpret_cast<uv_handle_t *>(async_->get()));
+        }
+      }
+
+      void addInFlight() {
+        if (inFlight_++ == 0) {
+          uv_ref(reinterpret_cast<uv_handle_t *>(async_->get()));
+        }
+      }
+
+    private:
+      std::shared_ptr<Loop> loop_;
+      std::size_t threadCount_;
+      std::shared_ptr<Async> async_;
+      std::vector<std::unique_ptr<Worker>> workers_;
+      // jobs queued and not taken yet, over all the threads
+      std::atomic<std::size_t> queued_{0};
+      std::atomic<std::size_t> sleeping_{0};
+      std::mutex sleepMutex_;
+      std::condition_variable cond_;
+      std::atomic<bool> stopping_{false};
+      MPSCQueue<Job *> completed_;
+      // loop thread only
+      std::size_t inFlight_{0};
+      std::size_t next_{0};
+  };
+} /* end of namspace: uvcpp */
+
+#endif /* end of include guard: UVCPP_WORK_EXECUTOR_H_ */
@@ -0,0 +1,112 @@
+/*******************************************************************************
+**          File: relay.cc
+**        Author: neevek <i@neevek.net>.
+** Creation Time: 2026-10-19 Mon 03:30 PM
+**   Description: loopback throughput of Relay in COPY and SPLICE mode,
+**                source, relay and sink all run on the same loop
+*******************************************************************************/
+#include "uvcpp.h"
+#include <chrono>
+#include <cstdio>
+
+using namespace uvcpp;
+
+namespace {
+  double run(Relay<Tcp>::Mode mode, std::size_t total, uint16_t port) {
+    const std::size_t CHUNK_SIZE = 64 * 1024;
+    const int WINDOW = 16;
+    const uint16_t sinkPort = port + 1;
+
+    auto loop = std::make_shared<Loop>();
+    if (!loop->init()) {
+      return 0;
+    }
+
+    auto sinkServer = Tcp::create(loop, Tcp::Domain::INET);
+    auto relayServer = Tcp::create(loop, Tcp::Domain::INET);
+    auto source = Tcp::create(loop);
+    std::shared_ptr<Tcp> sinkConn;
+
+    std::size_t sent = 0;
+    std::size_t received = 0;
+    auto start = std::chrono::steady_clock::now();
+    double elapsed = 0;
+
+    auto sendChunk = [&](Tcp &tcp) {
+      auto buf = loop->getBufferPool().acquire(CHUNK_SIZE);
+      buf->setLength(CHUNK_SIZE);
+      sent += CHUNK_SIZE;
+      tcp.writeAsync(std::move(buf));
+    };
+
+    source->on<EvWrite>([&](const auto &e, auto &source) {
+      if (sent < total) {
+        sendChunk(source);
+      }
+    });
+    source->once<EvConnect>([&](const auto &e, auto &source) {
+      start = std::chrono::steady_clock::now();
+      for (int i = 0; i < WINDOW; ++i) {
+        sendChunk(source);
+      }
+    });
+
+    sinkServer->on<EvAccept<Tcp>>([&](const auto &e, auto &s) {
+      sinkConn = std::move(const_cast<EvAccept<Tcp> &>(e).client);
+      sinkConn->on<EvRead>([&](const auto &e, auto &conn) {
+        received += e.nread;
+        if (received >= total) {
+          elapsed = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+          conn.close();
+          source->close();
+          sinkServer->close();
+          relayServer->close();
+        }
+      });
+      sinkConn->readStart();
+    });
+
+    auto actualMode = mode;
+    relayServer->on<EvAccept<Tcp>>([&](const auto &e, auto &s) {
+      auto a = e.client;
+      auto b = Tcp::create(loop);
+      b->once<EvConnect>([&, a, b](const auto &e, auto &conn) {
+        auto relay = Relay<Tcp>::create(a, b);
+        relay->setMode(mode);
+        relay->start();
+        actualMode = relay->getMode();
+      });
+      b->connect("127.0.0.1", sinkPort);
+    });
+
+    int on = 1;
+    sinkServer->setSockOption(
+      SO_REUSEADDR, reinterpret_cast<void *>(&on), sizeof(on));
+    relayServer->setSockOption(
+      SO_REUSEADDR, reinterpret_cast<void *>(&on), sizeof(on));
+    if (!sinkServer->bind("127.0.0.1", sinkPort) || !sinkServer->listen(50) ||
+        !relayServer->bind("127.0.0.1", port) || !relayServer->listen(50) ||
+        !source->connect("127.0.0.1", port)) {
+      return 0;
+    }
+
+    loop->run();
+
+    if (actualMode != mode) {
+      printf("SPLICE mode is not available, fell back to COPY\n");
+    }
+    return elapsed > 0 ? total / elapsed / (1024 * 1024) : 0;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  const std::size_t TOTAL_MB = argc > 1 ? atoi(argv[1]) : 2048;
+  const std::size_t total = TOTAL_MB * 1024 * 1024;
+
+  auto copy = run(Relay<Tcp>::Mode::COPY, total, 22346);
+  auto splice = run(Relay<Tcp>::Mode::SPLICE, total, 22348);
+  printf("relayed %zu MB, COPY: %.0f MB/s, SPLICE: %.0f MB/s\n",
+         TOTAL_MB, copy, splice);
+  return 0;
+}
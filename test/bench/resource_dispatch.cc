@@ -0,0 +1,189 @@
+/*******************************************************************************
+**          File: resource_dispatch.cc
+**        Author: neevek <i@neevek.net>.
+** Creation Time: 2026-10-17 Sat 04:20 PM
+**   Description: cost per publish of Resource event dispatching, compared
+**                with the previous std::function/unique_ptr<ICallback> one
+*******************************************************************************/
+#include "uvcpp.h"
+#include <chrono>
+#include <cstdio>
+
+using namespace uvcpp;
+
+namespace {
+  struct EvBench : public Event {
+    EvBench(int value) : value(value) { }
+    int value;
+  };
+
+  // the dispatching code Resource used before inline callback storage,
+  // including its per event type indexing
+  class LegacyDispatcher {
+    struct ICallback {
+      virtual ~ICallback() = default;
+    };
+
+    template <typename E>
+    struct Callback : public ICallback {
+      Callback(std::function<void(const E &, LegacyDispatcher &)> callback) :
+        callback(callback) { }
+      std::function<void(const E &, LegacyDispatcher &)> callback;
+    };
+
+    using CallbackVector = std::vector<std::unique_ptr<ICallback>>;
+
+    public:
+      template <typename E>
+      void on(std::function<void(const E &, LegacyDispatcher &)> &&cb) {
+        add<E>(callbacks_, getEventTypeIndex<E, 0>(), std::move(cb));
+      }
+
+      template <typename E>
+      void once(std::function<void(const E &, LegacyDispatcher &)> &&cb) {
+        add<E>(onceCallbacks_, getEventTypeIndex<E, 1>(), std::move(cb));
+      }
+
+      template <typename E>
+      void publish(E &&event) {
+        auto index = getEventTypeIndex<E, 0>();
+        if (index < callbacks_.size()) {
+          auto &tmp = callbacks_[index];
+          for (auto &c : tmp) {
+            static_cast<Callback<E> *>(c.get())->callback(event, *this);
+          }
+        }
+
+        index = getEventTypeIndex<E, 1>();
+        if (index < onceCallbacks_.size()) {
+          CallbackVector tmp;
+          onceCallbacks_[index].swap(tmp);
+          for (auto &c : tmp) {
+            static_cast<Callback<E> *>(c.get())->callback(event, *this);
+          }
+        }
+      }
+
+    private:
+      template <typename E>
+      void add(
+        std::vector<CallbackVector> &vec, std::size_t index,
+        std::function<void(const E &, LegacyDispatcher &)> &&cb) {
+        if (index >= vec.size()) {
+          vec.resize(index + 1);
+        }
+        vec[index].push_back(std::make_unique<Callback<E>>(std::move(cb)));
+      }
+
+      template <int>
+      static std::size_t countEventTypeIndex() {
+        static std::size_t index = 0;
+        return index++;
+      }
+
+      template <typename E, int t>
+      static std::size_t getEventTypeIndex() {
+        static std::size_t index = countEventTypeIndex<t>();
+        return index;
+      }
+
+    private:
+      std::vector<CallbackVector> callbacks_;
+      std::vector<CallbackVector> onceCallbacks_;
+  };
+
+  template <typename F>
+  double nsPerOp(long iterations, F &&f) {
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; ++i) {
+      f(i);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() /
+      iterations;
+  }
+
+  void report(const char *name, double legacy, double current) {
+    printf("%-28s legacy: %7.2f ns  current: %7.2f ns  speedup: %.2fx\n",
+           name, legacy, current, legacy / current);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  const long ITERATIONS = argc > 1 ? atol(argv[1]) : 10000000;
+
+  auto loop = std::make_shared<Loop>();
+  if (!loop->init()) {
+    return 1;
+  }
+  auto handle = Prepare::create(loop);
+
+  // captures two pointers, the common shape of callbacks in practice
+  volatile long sink = 0;
+  auto *sinkPtr = &sink;
+  long extra = 1;
+  auto *extraPtr = &extra;
+
+  {
+    LegacyDispatcher legacy;
+    legacy.on<EvBench>([sinkPtr, extraPtr](const auto &e, auto &d) {
+      *sinkPtr += e.value + *extraPtr;
+    });
+    auto legacyNs = nsPerOp(ITERATIONS, [&](long i) {
+      legacy.publish(EvBench{ static_cast<int>(i) });
+    });
+
+    handle->on<EvBench>([sinkPtr, extraPtr](const auto &e, auto &h) {
+      *sinkPtr += e.value + *extraPtr;
+    });
+    auto currentNs = nsPerOp(ITERATIONS, [&](long i) {
+      handle->publish(EvBench{ static_cast<int>(i) });
+    });
+    report("publish, 1 listener", legacyNs, currentNs);
+  }
+
+  {
+    LegacyDispatcher legacy;
+    auto legacyNs = nsPerOp(ITERATIONS, [&](long i) {
+      legacy.once<EvBench>([sinkPtr, extraPtr](const auto &e, auto &d) {
+        *sinkPtr += e.value + *extraPtr;
+      });
+      legacy.publish(EvBench{ static_cast<int>(i) });
+    });
+
+    auto currentNs = nsPerOp(ITERATIONS, [&](long i) {
+      handle->once<EvBench>([sinkPtr, extraPtr](const auto &e, auto &h) {
+        *sinkPtr += e.value + *extraPtr;
+      });
+      handle->publish(EvBench{ static_cast<int>(i) });
+    });
+    report("once + publish", legacyNs, currentNs);
+  }
+
+  {
+    LegacyDispatcher legacy;
+    for (int i = 0; i < 2; ++i) {
+      legacy.on<EvBench>([sinkPtr, extraPtr](const auto &e, auto &d) {
+        *sinkPtr += e.value + *extraPtr;
+      });
+      handle->on<EvBench>([sinkPtr, extraPtr](const auto &e, auto &h) {
+        *sinkPtr += e.value + *extraPtr;
+      });
+    }
+    legacy.on<EvBench>([sinkPtr, extraPtr](const auto &e, auto &d) {
+      *sinkPtr += e.value + *extraPtr;
+    });
+
+    auto legacyNs = nsPerOp(ITERATIONS, [&](long i) {
+      legacy.publish(EvBench{ static_cast<int>(i) });
+    });
+    auto currentNs = nsPerOp(ITERATIONS, [&](long i) {
+      handle->publish(EvBench{ static_cast<int>(i) });
+    });
+    report("publish, 3 listeners", legacyNs, currentNs);
+  }
+
+  handle->close();
+  loop->run();
+  return 0;
+}
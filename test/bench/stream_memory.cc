@@ -0,0 +1,47 @@
+/*******************************************************************************
+**          File: stream_memory.cc
+**        Author: neevek <i@neevek.net>.
+** Creation Time: 2026-10-17 Sat 07:02 PM
+**   Description: memory per Tcp connection, built twice, with and without
+**                UVCPP_STREAM_SHARED_READ_BUF
+*******************************************************************************/
+#include "uvcpp.h"
+#include <cstdio>
+#include <malloc.h>
+
+using namespace uvcpp;
+
+int main(int argc, char *argv[]) {
+  const int COUNT = argc > 1 ? atoi(argv[1]) : 200000;
+
+  auto loop = std::make_shared<Loop>();
+  if (!loop->init()) {
+    return 1;
+  }
+
+  std::vector<std::shared_ptr<Tcp>> handles;
+  handles.reserve(COUNT);
+
+  auto before = mallinfo2().uordblks;
+  for (int i = 0; i < COUNT; ++i) {
+    handles.push_back(Tcp::create(loop));
+  }
+  auto after = mallinfo2().uordblks;
+
+  auto perConnection = static_cast<double>(after - before) / COUNT;
+#ifdef UVCPP_STREAM_SHARED_READ_BUF
+  auto mode = "shared loop read buffer";
+#else
+  auto mode = "embedded read buffer";
+#endif
+  printf("%s: sizeof(Tcp)=%zu, heap per connection: %.0f bytes, "
+         "%d connections: %.1f MB\n",
+         mode, sizeof(Tcp), perConnection, COUNT,
+         perConnection * COUNT / (1024 * 1024));
+
+  for (auto &h : handles) {
+    h->close();
+  }
+  loop->run();
+  return 0;
+}
@@ -0,0 +1,95 @@
+/*******************************************************************************
+**          File: stream_read.cc
+**        Author: neevek <i@neevek.net>.
+** Creation Time: 2026-10-20 Tue 10:20 AM
+**   Description: reads and throughput of a bulk transfer over loopback,
+**                with the fixed read buffer and with adaptive read buffers
+*******************************************************************************/
+#include "uvcpp.h"
+#include <chrono>
+#include <cstdio>
+
+using namespace uvcpp;
+
+namespace {
+  void run(bool adaptive, std::size_t total, uint16_t port) {
+    const std::size_t CHUNK_SIZE = 256 * 1024;
+    const int WINDOW = 8;
+
+    auto loop = std::make_shared<Loop>();
+    if (!loop->init()) {
+      return;
+    }
+
+    auto server = Tcp::create(loop, Tcp::Domain::INET);
+    auto client = Tcp::create(loop);
+    std::shared_ptr<Tcp> conn;
+
+    std::size_t sent = 0;
+    std::size_t received = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    auto sendChunk = [&](Tcp &tcp) {
+      auto buf = std::make_unique<nul::Buffer>(CHUNK_SIZE);
+      buf->setLength(CHUNK_SIZE);
+      sent += CHUNK_SIZE;
+      tcp.writeAsync(std::move(buf));
+    };
+
+    client->on<EvWrite>([&](const auto &e, auto &client) {
+      if (sent < total) {
+        sendChunk(client);
+      }
+    });
+    client->once<EvConnect>([&](const auto &e, auto &client) {
+      start = std::chrono::steady_clock::now();
+      for (int i = 0; i < WINDOW; ++i) {
+        sendChunk(client);
+      }
+    });
+
+    server->on<EvAccept<Tcp>>([&](const auto &e, auto &s) {
+      conn = std::move(const_cast<EvAccept<Tcp> &>(e).client);
+      if (adaptive) {
+        conn->setAdaptiveReadBuffers();
+      }
+      conn->on<EvRead>([&](const auto &e, auto &conn) {
+        received += e.nread;
+        if (received < total) {
+          return;
+        }
+        auto elapsed = std::chrono::duration<double>(
+          std::chrono::steady_clock::now() - start).count();
+        auto &stats = conn.getReadStats();
+        printf("%-8s %llu reads, %.0f bytes/read, %.0f MB/s\n",
+               adaptive ? "adaptive" : "fixed",
+               static_cast<unsigned long long>(stats.reads),
+               static_cast<double>(stats.bytes) / stats.reads,
+               total / elapsed / (1024 * 1024));
+        conn.close();
+        client->close();
+        server->close();
+      });
+      conn->readStart();
+    });
+
+    int on = 1;
+    server->setSockOption(
+      SO_REUSEADDR, reinterpret_cast<void *>(&on), sizeof(on));
+    if (!server->bind("127.0.0.1", port) || !server->listen(50) ||
+        !client->connect("127.0.0.1", port)) {
+      return;
+    }
+
+    loop->run();
+  }
+}
+
+int main(int argc, char *argv[]) {
+  const std::size_t TOTAL_MB = argc > 1 ? atoi(argv[1]) : 1024;
+  const std::size_t total = TOTAL_MB * 1024 * 1024;
+
+  run(false, total, 22354);
+  run(true, total, 22355);
+  return 0;
+}
@@ -0,0 +1,129 @@
+/*******************************************************************************
+**          File: stream_write.cc
+**        Author: neevek <i@neevek.net>.
+** Creation Time: 2026-10-18 Sun 02:15 PM
+**   Description: writeAsync calls per second on one loop (one core), with
+**                a window of small writes in flight over loopback, and the
+**                heap allocations made per write
+*******************************************************************************/
+#include "uvcpp.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+using namespace uvcpp;
+
+namespace {
+  std::atomic<uint64_t> allocCount{0};
+
+  void *countedAlloc(std::size_t size) {
+    allocCount.fetch_add(1, std::memory_order_relaxed);
+    if (auto p = std::malloc(size ? size : 1)) {
+      return p;
+    }
+    throw std::bad_alloc();
+  }
+}
+
+// all the forms are replaced, and kept out of line, so the compiler never
+// sees std::free paired with an operator new it doesn't know is malloc
+__attribute__((noinline)) void *operator new(std::size_t size) {
+  return countedAlloc(size);
+}
+
+__attribute__((noinline)) void *operator new[](std::size_t size) {
+  return countedAlloc(size);
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+  std::free(p);
+}
+
+__attribute__((noinline)) void operator delete[](void *p) noexcept {
+  std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(
+    void *p, std::size_t) noexcept {
+  std::free(p);
+}
+
+__attribute__((noinline)) void operator delete[](
+    void *p, std::size_t) noexcept {
+  std::free(p);
+}
+
+int main(int argc, char *argv[]) {
+  const int COUNT = argc > 1 ? atoi(argv[1]) : 2000000;
+  const int WINDOW = argc > 2 ? atoi(argv[2]) : 64;
+  const int WRITE_SIZE = 64;
+  const int WARMUP = WINDOW * 4;
+
+  auto loop = std::make_shared<Loop>();
+  if (!loop->init()) {
+    return 1;
+  }
+
+  auto server = Tcp::create(loop, Tcp::Domain::INET);
+  auto client = Tcp::create(loop);
+  std::shared_ptr<Tcp> conn;
+
+  auto &pool = loop->getBufferPool();
+  auto issued = 0;
+  auto completed = 0;
+  uint64_t allocsAtWarmup = 0;
+  auto start = std::chrono::steady_clock::now();
+
+  auto writeOne = [&](Tcp &tcp) {
+    auto buf = pool.acquire(WRITE_SIZE);
+    buf->setLength(WRITE_SIZE);
+    ++issued;
+    tcp.writeAsync(std::move(buf));
+  };
+
+  client->on<EvWrite>([&](const auto &e, auto &client) {
+    if (++completed == WARMUP) {
+      allocsAtWarmup = allocCount.load();
+      start = std::chrono::steady_clock::now();
+    }
+    if (issued < COUNT + WARMUP) {
+      writeOne(client);
+    } else if (completed == issued) {
+      auto elapsed = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+      auto allocs = allocCount.load() - allocsAtWarmup;
+      printf("%d writes of %d bytes, window %d: %.0f writes/sec, "
+             "%.3f allocations per write\n",
+             COUNT, WRITE_SIZE, WINDOW, COUNT / elapsed,
+             static_cast<double>(allocs) / COUNT);
+      client.close();
+      conn->close();
+      server->close();
+    }
+  });
+
+  client->once<EvConnect>([&](const auto &e, auto &client) {
+    for (int i = 0; i < WINDOW; ++i) {
+      writeOne(client);
+    }
+  });
+
+  server->on<EvAccept<Tcp>>([&](const auto &e, auto &s) {
+    conn = std::move(const_cast<EvAccept<Tcp> &>(e).client);
+    conn->on<EvRead>([](const auto &e, auto &c) { });
+    conn->readStart();
+  });
+
+  int on = 1;
+  server->setSockOption(
+    SO_REUSEADDR, reinterpret_cast<void *>(&on), sizeof(on));
+  if (!server->bind("127.0.0.1", 22345) || !server->listen(50) ||
+      !client->connect("127.0.0.1", 22345)) {
+    return 1;
+  }
+
+  loop->run();
+  return 0;
+}
@@ -0,0 +1,159 @@
+/*******************************************************************************
+**          File: timer_wheel.cc
+**        Author: neevek <i@neevek.net>.
+** Creation Time: 2026-10-24 Sat 02:30 PM
+**   Description: idle timeouts of many connections, one Timer per connection
+**                against one TimerWheel entry per connection: arming them,
+**                resetting them as reads come in, and letting them expire
+*******************************************************************************/
+#include "uvcpp.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <sys/resource.h>
+
+using namespace uvcpp;
+
+namespace {
+  const uint64_t IDLE_TIMEOUT = 30000;
+
+  using Clock = std::chrono::steady_clock;
+
+  double nsPerOp(Clock::time_point start, std::size_t ops) {
+    return std::chrono::duration<double, std::nano>(
+      Clock::now() - start).count() / ops;
+  }
+
+  long maxRssKB() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+  }
+
+  // the order reads come in on the connections
+  std::vector<int> readOrder(int conns, int resets) {
+    std::vector<int> order;
+    order.reserve(static_cast<std::size_t>(conns) * resets);
+    std::mt19937 rng(1);
+    std::vector<int> round(conns);
+    for (int i = 0; i < conns; ++i) {
+      round[i] = i;
+    }
+    for (int r = 0; r < resets; ++r) {
+      std::shuffle(round.begin(), round.end(), rng);
+      order.insert(order.end(), round.begin(), round.end());
+    }
+    return order;
+  }
+
+  void report(const char *name, double arm, double reset,
+              double expire, long rssBefore) {
+    printf("%-14s arm %6.0f ns  reset %6.0f ns  expire %6.0f ns  "
+           "peak rss +%ld KB\n",
+           name, arm, reset, expire, maxRssKB() - rssBefore);
+  }
+
+  void runTimers(int conns, const std::vector<int> &order) {
+    auto loop = std::make_shared<Loop>();
+    if (!loop->init()) {
+      return;
+    }
+    auto rssBefore = maxRssKB();
+
+    std::vector<std::shared_ptr<Timer>> timers;
+    timers.reserve(conns);
+    auto fired = 0;
+
+    auto start = Clock::now();
+    for (int i = 0; i < conns; ++i) {
+      auto timer = Timer::create(loop);
+      timer->on<EvTimer>([&fired](const auto &e, auto &timer) {
+        ++fired;
+        timer.close();
+      });
+      timer->start(IDLE_TIMEOUT, 0);
+      timers.push_back(std::move(timer));
+    }
+    auto arm = nsPerOp(start, conns);
+
+    start = Clock::now();
+    for (auto i : order) {
+      timers[i]->start(IDLE_TIMEOUT, 0);
+    }
+    auto reset = nsPerOp(start, order.size());
+
+    // the connections go idle, spread over 100 ms
+    uv_update_time(loop->getRaw());
+    start = Clock::now();
+    for (int i = 0; i < conns; ++i) {
+      timers[i]->start(1 + i % 100, 0);
+    }
+    loop->run();
+    auto expire = nsPerOp(start, conns);
+
+    report("Timer", arm, reset, expire, rssBefore);
+    if (fired != conns) {
+      printf("only %d of %d timers fired\n", fired, conns);
+    }
+  }
+
+  struct IdleEntry : public TimerWheel::Entry {
+    virtual void onTimeout() override {
+      ++*fired;
+    }
+    int *fired;
+  };
+
+  void runWheel(int conns, const std::vector<int> &order) {
+    auto loop = std::make_shared<Loop>();
+    if (!loop->init()) {
+      return;
+    }
+    auto rssBefore = maxRssKB();
+
+    auto fired = 0;
+    {
+      TimerWheel wheel(loop->getRaw());
+      std::vector<IdleEntry> entries(conns);
+
+      auto start = Clock::now();
+      for (auto &entry : entries) {
+        entry.fired = &fired;
+        wheel.schedule(&entry, IDLE_TIMEOUT);
+      }
+      auto arm = nsPerOp(start, conns);
+
+      start = Clock::now();
+      for (auto i : order) {
+        wheel.schedule(&entries[i], IDLE_TIMEOUT);
+      }
+      auto reset = nsPerOp(start, order.size());
+
+      uv_update_time(loop->getRaw());
+      start = Clock::now();
+      for (int i = 0; i < conns; ++i) {
+        wheel.schedule(&entries[i], 1 + i % 100);
+      }
+      loop->run();
+      auto expire = nsPerOp(start, conns);
+
+      report("TimerWheel", arm, reset, expire, rssBefore);
+    }
+    if (fired != conns) {
+      printf("only %d of %d entries fired\n", fired, conns);
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
+  const int CONNS = argc > 1 ? atoi(argv[1]) : 500000;
+  const int RESETS = argc > 2 ? atoi(argv[2]) : 10;
+  auto order = readOrder(CONNS, RESETS);
+  printf("%d connections, %d resets each\n", CONNS, RESETS);
+  // the wheel first, the peak rss of the Timers then includes its own
+  runWheel(CONNS, order);
+  runTimers(CONNS, order);
+  return 0;
+}
@@ -0,0 +1,180 @@
+/*******************************************************************************
+**          File: udp_recv.cc
+**        Author: neevek <i@neevek.net>.
+** Creation Time: 2026-10-20 Tue 04:40 PM
+**   Description: datagrams received per second on one loop, with EvRecv,
+**                with EvRecvBatch, and with EvRecvBatch plus GRO. the socket
+**                buffer is filled with a backlog of small datagrams, and the
+**                time it takes to drain it is measured, like a busy server
+**                that is always behind. the backlog is sent with GSO in the
+**                GRO run, as loopback only coalesces what was sent that way
+*******************************************************************************/
+#include "uvcpp.h"
+#include <chrono>
+#include <cstdio>
+
+using namespace uvcpp;
+
+namespace {
+  const int PACKET_SIZE = 64;
+  const int BACKLOG = 2048;
+
+  enum class Mode { RECV, BATCH, GRO };
+
+  void fill(int fd) {
+    const int BATCH = 64;
+    char packet[PACKET_SIZE] = { 0 };
+    iovec iov{ packet, sizeof(packet) };
+    mmsghdr msgs[BATCH];
+    memset(msgs, 0, sizeof(msgs));
+    for (auto &msg : msgs) {
+      msg.msg_hdr.msg_iov = &iov;
+      msg.msg_hdr.msg_iovlen = 1;
+    }
+    for (int sent = 0; sent < BACKLOG; ) {
+      auto n = sendmmsg(fd, msgs, BATCH, 0);
+      if (n <= 0) {
+        return;
+      }
+      sent += n;
+    }
+  }
+
+  void fillWithGso(int fd) {
+    const int SEGMENTS = 64;
+    static char payload[PACKET_SIZE * SEGMENTS];
+    iovec iov{ payload, sizeof(payload) };
+    char control[CMSG_SPACE(sizeof(uint16_t))];
+    msghdr hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = control;
+    hdr.msg_controllen = sizeof(control);
+    auto cm = CMSG_FIRSTHDR(&hdr);
+    cm->cmsg_level = SOL_UDP;
+    cm->cmsg_type = UDP_SEGMENT;
+    cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+    uint16_t segmentSize = PACKET_SIZE;
+    memcpy(CMSG_DATA(cm), &segmentSize, sizeof(segmentSize));
+    for (int sent = 0; sent < BACKLOG; sent += SEGMENTS) {
+      if (sendmsg(fd, &hdr, 0) <= 0) {
+        return;
+      }
+    }
+  }
+
+  void run(Mode mode, uint16_t port, int rounds) {
+    auto batch = mode != Mode::RECV;
+    auto loop = std::make_shared<Loop>();
+    if (!loop->init()) {
+      return;
+    }
+
+    auto server = Udp<>::create(loop);
+    auto watchdog = Timer::create(loop);
+    if (!server || !watchdog || !server->bind("127.0.0.1", port)) {
+      return;
+    }
+    if (mode == Mode::GRO && !server->setGro(true)) {
+      printf("GRO is not supported\n");
+      return;
+    }
+    uv_os_fd_t serverFd;
+    int rcvbuf = 4 * 1024 * 1024;
+    if (uv_fileno(
+          reinterpret_cast<uv_handle_t *>(server->get()), &serverFd) == 0) {
+      setsockopt(serverFd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    }
+
+    auto fd = socket(AF_INET, SOCK_DGRAM, 0);
+    connect(fd, server->getLocalSockAddr(), sizeof(sockaddr_in));
+
+    uint64_t total = 0;
+    uint64_t batches = 0;
+    int received = 0;
+    int round = 0;
+    auto start = std::chrono::steady_clock::now();
+    double elapsed = 0;
+
+    auto startRound = [&]() {
+      if (mode == Mode::GRO) {
+        fillWithGso(fd);
+      } else {
+        fill(fd);
+      }
+      received = 0;
+      start = std::chrono::steady_clock::now();
+      if (batch) {
+        server->recvBatchStart();
+      } else {
+        server->recvStart();
+      }
+    };
+    auto onReceived = [&](int count) {
+      received += count;
+      if (received < BACKLOG) {
+        return;
+      }
+      elapsed += std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+      total += received;
+      if (batch) {
+        server->recvBatchStop();
+      } else {
+        server->recvStop();
+      }
+      if (++round < rounds) {
+        startRound();
+      } else {
+        server->close();
+        watchdog->close();
+      }
+    };
+
+    // a round never completes if the kernel dropped some of the backlog
+    auto lastProgress = total;
+    watchdog->on<EvTimer>([&](const auto &e, auto &watchdog) {
+      if (total + received == lastProgress) {
+        server->close();
+        watchdog.close();
+      }
+      lastProgress = total + received;
+    });
+    watchdog->start(1000, 1000);
+
+    server->on<EvRecv>([&](const auto &e, auto &server) {
+      onReceived(1);
+    });
+    server->on<EvRecvBatch>([&](const auto &e, auto &server) {
+      ++batches;
+      onReceived(e.size());
+    });
+
+    startRound();
+    loop->run();
+    close(fd);
+
+    if (round < rounds) {
+      printf("datagrams were dropped, lower BACKLOG\n");
+      return;
+    }
+    printf("%-17s %.0f datagrams/sec",
+           mode == Mode::RECV ? "EvRecv" :
+           mode == Mode::BATCH ? "EvRecvBatch" : "EvRecvBatch + GRO",
+           total / elapsed);
+    if (batch) {
+      printf(", %.1f datagrams per batch",
+             static_cast<double>(total) / batches);
+    }
+    printf("\n");
+  }
+}
+
+int main(int argc, char *argv[]) {
+  const int ROUNDS = argc > 1 ? atoi(argv[1]) : 500;
+  run(Mode::RECV, 22356, ROUNDS);
+  run(Mode::BATCH, 22357, ROUNDS);
+  run(Mode::GRO, 22361, ROUNDS);
+  return 0;
+}
@@ -0,0 +1,111 @@
+/*******************************************************************************
+**          File: udp_send.cc
+**        Author: neevek <i@neevek.net>.
+** Creation Time: 2026-10-21 Wed 11:10 AM
+**   Description: datagrams sent per second on one loop, with send(), with
+**                send() on a connected handle, with trySend() on a connected
+**                handle, with sendBatch() and with sendBatch() plus GSO, to
+**                a loopback socket that is never read from
+*******************************************************************************/
+#include "uvcpp.h"
+#include <chrono>
+#include <cstdio>
+
+using namespace uvcpp;
+
+namespace {
+  const int PACKET_SIZE = 1200;
+  const int WINDOW = 1024;
+
+  enum class Mode { SEND, CONNECTED, TRY_SEND, BATCH, GSO };
+
+  void run(Mode mode, int count, uint16_t port) {
+    auto loop = std::make_shared<Loop>();
+    if (!loop->init()) {
+      return;
+    }
+
+    auto sink = Udp<>::create(loop);
+    auto client = Udp<>::create(loop);
+    if (!sink || !client || !sink->bind("127.0.0.1", port) ||
+        !client->bind("127.0.0.1", 0)) {
+      return;
+    }
+    if ((mode == Mode::CONNECTED || mode == Mode::TRY_SEND) &&
+        !client->connect(sink->getLocalSockAddr())) {
+      return;
+    }
+    if (mode == Mode::GSO && !client->setGso(true)) {
+      printf("GSO is not supported\n");
+      return;
+    }
+
+    auto &pool = loop->getBufferPool();
+    auto issued = 0;
+    auto completed = 0;
+    auto inFlight = 0;
+    // trySend completes inline, so completions must not re-enter sendWindow
+    auto sending = false;
+    auto start = std::chrono::steady_clock::now();
+
+    auto sendWindow = [&]() {
+      sending = true;
+      do {
+        for (int i = 0; i < WINDOW && issued < count; ++i) {
+          ++issued;
+          ++inFlight;
+          auto buf = pool.acquire(PACKET_SIZE);
+          buf->setLength(PACKET_SIZE);
+          if (mode == Mode::SEND) {
+            client->send(std::move(buf), sink->getLocalSockAddr());
+          } else if (mode == Mode::CONNECTED) {
+            client->send(std::move(buf));
+          } else if (mode == Mode::TRY_SEND) {
+            client->trySend(std::move(buf));
+          } else {
+            client->sendBatch(std::move(buf), sink->getLocalSockAddr());
+          }
+        }
+      } while (inFlight == 0 && issued < count);
+      sending = false;
+    };
+    auto onCompleted = [&](int n) {
+      completed += n;
+      inFlight -= n;
+      if (completed == count) {
+        auto elapsed = std::chrono::duration<double>(
+          std::chrono::steady_clock::now() - start).count();
+        printf("%-20s %.0f datagrams/sec\n",
+               mode == Mode::SEND ? "send()" :
+               mode == Mode::CONNECTED ? "connected send()" :
+               mode == Mode::TRY_SEND ? "connected trySend()" :
+               mode == Mode::BATCH ? "sendBatch()" : "sendBatch() + GSO",
+               count / elapsed);
+        client->close();
+        sink->close();
+      } else if (inFlight == 0 && !sending) {
+        sendWindow();
+      }
+    };
+
+    client->on<EvSend>([&](const auto &e, auto &client) {
+      onCompleted(1);
+    });
+    client->on<EvSendBatch>([&](const auto &e, auto &client) {
+      onCompleted(e.sent);
+    });
+
+    sendWindow();
+    loop->run();
+  }
+}
+
+int main(int argc, char *argv[]) {
+  const int COUNT = argc > 1 ? atoi(argv[1]) : 2000000;
+  run(Mode::SEND, COUNT, 22358);
+  run(Mode::CONNECTED, COUNT, 22362);
+  run(Mode::TRY_SEND, COUNT, 22363);
+  run(Mode::BATCH, COUNT, 22359);
+  run(Mode::GSO, COUNT, 22360);
+  return 0;
+}
@@ -0,0 +1,167 @@
+/*******************************************************************************
+**          File: work_pool.cc
+**        Author: neevek <i@neevek.net>.
+** Creation Time: 2026-10-26 Mon 10:15 AM
+**   Description: small CPU jobs completed per second on one loop, with
+**                uv_queue_work, with WorkExecutor::submit, with
+**                WorkExecutor::submitBatch and with WorkExecutor::parallelFor,
+**                the executor gets as many threads as the libuv threadpool
+*******************************************************************************/
+#include "uvcpp.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+using namespace uvcpp;
+
+namespace {
+  const int WINDOW = 4096;
+
+  enum class Mode { QUEUE_WORK, SUBMIT, BATCH, PARALLEL_FOR };
+
+  const char *modeName(Mode mode) {
+    switch (mode) {
+      case Mode::QUEUE_WORK: return "uv_queue_work";
+      case Mode::SUBMIT: return "submit";
+      case Mode::BATCH: return "submitBatch";
+      default: return "parallelFor";
+    }
+  }
+
+  // a few hundred ns of work, like hashing a small header
+  uint64_t job(uint64_t seed, int spin) {
+    auto h = seed + 0x9e3779b97f4a7c15ULL;
+    for (int i = 0; i < spin; ++i) {
+      h ^= h >> 33;
+      h *= 0xff51afd7ed558ccdULL;
+    }
+    return h;
+  }
+
+  struct QueueWork {
+    uv_work_t req;
+    int spin;
+    int slot;
+    uint64_t result;
+    std::function<void(int)> *after;
+  };
+
+  void run(Mode mode, int count, int spin, std::size_t threads) {
+    auto loop = std::make_shared<Loop>();
+    if (!loop->init()) {
+      return;
+    }
+    WorkExecutor executor{loop, threads};
+    if (mode != Mode::QUEUE_WORK && !executor.start()) {
+      return;
+    }
+
+    auto issued = 0;
+    auto completed = 0;
+    uint64_t sink = 0;
+    std::vector<QueueWork> reqs(mode == Mode::QUEUE_WORK ? WINDOW : 0);
+    std::function<void(int)> refill;
+    std::function<void()> submitBatch;
+    std::vector<uint64_t> results;
+    auto start = std::chrono::steady_clock::now();
+
+    std::function<void(int)> submitOne = [&](int slot) {
+      ++issued;
+      if (mode == Mode::QUEUE_WORK) {
+        auto &w = reqs[slot];
+        w.req.data = &w;
+        w.spin = spin;
+        w.slot = slot;
+        w.after = &refill;
+        uv_queue_work(loop->getRaw(), &w.req, [](uv_work_t *req) {
+          auto w = reinterpret_cast<QueueWork *>(req->data);
+          w->result = job(reinterpret_cast<uintptr_t>(w), w->spin);
+        }, [](uv_work_t *req, int status) {
+          auto w = reinterpret_cast<QueueWork *>(req->data);
+          (*w->after)(w->slot);
+        });
+      } else {
+        executor.submit([spin, issued]{ return job(issued, spin); },
+                        [&](WorkResult<uint64_t> &r) {
+          sink += r.get();
+          ++completed;
+          if (issued < count) {
+            submitOne(0);
+          }
+        });
+      }
+    };
+
+    if (mode == Mode::QUEUE_WORK) {
+      // every request slot is reused as soon as it completes
+      refill = [&](int slot) {
+        sink += reqs[slot].result;
+        ++completed;
+        if (issued < count) {
+          submitOne(slot);
+        }
+      };
+      for (int i = 0; i < WINDOW && issued < count; ++i) {
+        submitOne(i);
+      }
+    } else if (mode == Mode::SUBMIT) {
+      for (int i = 0; i < WINDOW && issued < count; ++i) {
+        submitOne(0);
+      }
+    } else if (mode == Mode::BATCH) {
+      submitBatch = [&]{
+        std::vector<std::function<uint64_t()>> jobs;
+        for (int i = 0; i < WINDOW && issued < count; ++i, ++issued) {
+          jobs.push_back([spin, issued]{ return job(issued, spin); });
+        }
+        executor.submitBatch(std::move(jobs), [&](auto &results) {
+          for (auto &r : results) {
+            sink += r.get();
+          }
+          completed += results.size();
+          if (issued < count) {
+            submitBatch();
+          }
+        });
+      };
+      submitBatch();
+    } else {
+      results.resize(count);
+      executor.parallelFor(0, count, 0, [&results, spin](std::size_t i) {
+        results[i] = job(i, spin);
+      }, [&](WorkResult<void> &r) {
+        for (auto v : results) {
+          sink += v;
+        }
+        completed = count;
+      });
+    }
+
+    loop->run();
+    auto elapsed = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+
+    executor.shutdown();
+    loop->run();
+
+    printf("%-14s %8d jobs in %6.3f s, %10.0f jobs/s (%llx)\n",
+           modeName(mode), completed, elapsed, completed / elapsed,
+           static_cast<unsigned long long>(sink & 0xf));
+  }
+}
+
+int main(int argc, char *argv[]) {
+  const int COUNT = argc > 1 ? atoi(argv[1]) : 1000000;
+  const int SPIN = argc > 2 ? atoi(argv[2]) : 50;
+  auto env = getenv("UV_THREADPOOL_SIZE");
+  const std::size_t THREADS = env ? atoi(env) : 4;
+
+  printf("%d jobs of %d rounds, %zu threads\n", COUNT, SPIN, THREADS);
+  run(Mode::QUEUE_WORK, COUNT, SPIN, THREADS);
+  run(Mode::SUBMIT, COUNT, SPIN, THREADS);
+  run(Mode::BATCH, COUNT, SPIN, THREADS);
+  run(Mode::PARALLEL_FOR, COUNT, SPIN, THREADS);
+  return 0;
+}
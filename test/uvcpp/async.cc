@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+#include "uvcpp.h"
+#include <thread>
+
+using namespace uvcpp;
+
+TEST(Async, SendFromThread) {
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  auto async = Async::create(loop);
+  ASSERT_TRUE(!!async);
+
+  auto count = 0;
+  async->on<EvAsync>([&count](const auto &e, auto &async) {
+    ++count;
+    async.close();
+  });
+
+  std::thread t([async]{ async->send(); });
+  loop->run();
+  t.join();
+
+  ASSERT_EQ(count, 1);
+}
+
+TEST(Loop, PostFromThreads) {
+  const auto THREAD_COUNT = 4;
+  const auto TASK_COUNT = 10000;
+
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+  loop->setKeepAlive(true);
+
+  auto count = 0;
+  auto loopThreadId = std::this_thread::get_id();
+  std::vector<std::thread> threads;
+  for (int i = 0; i < THREAD_COUNT; ++i) {
+    threads.emplace_back([&]{
+      for (int j = 0; j < TASK_COUNT; ++j) {
+        loop->post([&]{
+          ASSERT_EQ(std::this_thread::get_id(), loopThreadId);
+          if (++count == THREAD_COUNT * TASK_COUNT) {
+            loop->setKeepAlive(false);
+          }
+        });
+      }
+    });
+  }
+
+  loop->run();
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  ASSERT_EQ(count, THREAD_COUNT * TASK_COUNT);
+}
+
+TEST(Loop, PostDoesNotKeepLoopAlive) {
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  auto ran = false;
+  loop->post([&ran]{ ran = true; });
+
+  // the loop has no active handle, so run() returns immediately
+  loop->run();
+  ASSERT_FALSE(ran);
+
+  loop->setKeepAlive(true);
+  loop->post([&]{
+    ran = true;
+    loop->setKeepAlive(false);
+  });
+  loop->run();
+  ASSERT_TRUE(ran);
+}
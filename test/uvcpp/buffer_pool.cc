@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+#include "uvcpp.h"
+
+using namespace uvcpp;
+
+TEST(BufferPool, SizeClasses) {
+  BufferPool pool;
+
+  auto b1 = pool.acquire(100);
+  ASSERT_EQ(b1->getCapacity(), 128);
+  auto b2 = pool.acquire(1);
+  ASSERT_EQ(b2->getCapacity(), 64);
+  auto big = pool.acquire(BufferPool::kMaxClassSize + 1);
+  ASSERT_EQ(big->getCapacity(), BufferPool::kMaxClassSize + 1);
+
+  ASSERT_EQ(pool.getStats().misses, 3);
+  ASSERT_EQ(pool.getStats().inUse, 2);
+  ASSERT_EQ(pool.getStats().highWater, 2);
+
+  auto raw = b1.get();
+  b1->setLength(10);
+  pool.release(std::move(b1));
+  pool.release(std::move(big));
+  pool.release(std::make_unique<nul::Buffer>(100));
+  ASSERT_EQ(pool.getStats().returns, 1);
+  ASSERT_EQ(pool.getStats().drops, 2);
+  ASSERT_EQ(pool.getStats().cached, 1);
+
+  auto b3 = pool.acquire(128);
+  ASSERT_EQ(b3.get(), raw);
+  ASSERT_EQ(b3->getLength(), 0);
+  ASSERT_EQ(pool.getStats().hits, 1);
+  ASSERT_EQ(pool.getStats().highWater, 2);
+
+  pool.setMaxCachedPerClass(0);
+  pool.release(std::move(b3));
+  ASSERT_EQ(pool.getStats().cached, 0);
+}
+
+TEST(BufferPool, ForeignBuffersNotInUse) {
+  BufferPool pool;
+
+  auto pooled = pool.acquire(64);
+  ASSERT_EQ(pool.getStats().inUse, 1);
+
+  // class sized, but never handed out by the pool
+  pool.release(std::make_unique<nul::Buffer>(64));
+  pool.release(std::make_unique<nul::Buffer>(128));
+  ASSERT_EQ(pool.getStats().inUse, 1);
+  ASSERT_EQ(pool.getStats().cached, 2);
+
+  // handed out from the free list, it counts from now on
+  auto foreign = pool.acquire(128);
+  ASSERT_EQ(pool.getStats().inUse, 2);
+  ASSERT_EQ(pool.getStats().highWater, 2);
+
+  pool.release(std::move(foreign));
+  pool.release(std::move(pooled));
+  ASSERT_EQ(pool.getStats().inUse, 0);
+  ASSERT_EQ(pool.getStats().highWater, 2);
+}
+
+TEST(BufferPool, InUseOfManyBuffers) {
+  BufferPool pool;
+
+  std::vector<std::unique_ptr<nul::Buffer>> buffers;
+  for (int i = 0; i < 1000; ++i) {
+    buffers.push_back(pool.acquire(64 << (i % 4)));
+  }
+  ASSERT_EQ(pool.getStats().inUse, 1000);
+
+  // taken back out of order, foreign ones in between
+  for (std::size_t i = 0; i < buffers.size(); i += 3) {
+    pool.release(std::move(buffers[i]));
+    pool.release(std::make_unique<nul::Buffer>(64));
+  }
+  ASSERT_EQ(pool.getStats().inUse, 666);
+  for (auto &buffer : buffers) {
+    pool.release(std::move(buffer));
+  }
+  ASSERT_EQ(pool.getStats().inUse, 0);
+  ASSERT_EQ(pool.getStats().highWater, 1000);
+
+  // a second round reuses the cached buffers, the foreign ones included
+  for (auto &buffer : buffers) {
+    buffer = pool.acquire(64);
+  }
+  ASSERT_EQ(pool.getStats().inUse, 1000);
+  buffers.clear();
+}
+
+TEST(BufferPool, RecycledWriteBuffersReturnToPool) {
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+  auto &pool = loop->getBufferPool();
+
+  auto server = Tcp::create(loop, Tcp::Domain::INET);
+  auto client = Tcp::create(loop);
+
+  const auto WRITE_COUNT = 10;
+  auto written = 0;
+  client->on<EvWrite>([&](const auto &e, auto &client) {
+    if (++written == WRITE_COUNT) {
+      client.close();
+      return;
+    }
+    auto buf = pool.acquire(1000);
+    buf->assign("x", 1);
+    client.writeAsync(std::move(buf));
+  });
+  client->once<EvConnect>([&](const auto &e, auto &client) {
+    auto buf = pool.acquire(1000);
+    buf->assign("x", 1);
+    client.writeAsync(std::move(buf));
+  });
+
+  auto received = 0;
+  std::shared_ptr<Tcp> acceptedClient;
+  server->on<EvAccept<Tcp>>([&](const auto &e, auto &s) {
+    e.client->template on<EvRead>([&](const auto &e, auto &c){
+      received += e.nread;
+      if (received == WRITE_COUNT) {
+        c.close();
+        s.close();
+      }
+    });
+    e.client->readStart();
+    acceptedClient = std::move(const_cast<EvAccept<Tcp> &>(e).client);
+  });
+
+  int on = 1;
+  server->setSockOption(
+    SO_REUSEADDR, reinterpret_cast<void *>(&on), sizeof(on));
+  ASSERT_TRUE(server->bind("127.0.0.1", 22338));
+  ASSERT_TRUE(server->listen(50));
+  ASSERT_TRUE(client->connect("127.0.0.1", 22338));
+
+  loop->run();
+
+  ASSERT_EQ(received, WRITE_COUNT);
+  // writes are sequential, so one buffer serves all of them
+  ASSERT_EQ(pool.getStats().misses, 1);
+  ASSERT_EQ(pool.getStats().hits, WRITE_COUNT - 1);
+  ASSERT_EQ(pool.getStats().highWater, 1);
+  ASSERT_EQ(pool.getStats().inUse, 0);
+}
@@ -0,0 +1,230 @@
+#include <gtest/gtest.h>
+#include "uvcpp.h"
+#include "coro.hpp"
+#include <thread>
+
+using namespace uvcpp;
+
+namespace {
+  std::unique_ptr<nul::Buffer> makeBuffer(
+      Loop &loop, const char *data, std::size_t len) {
+    auto buf = loop.getBufferPool().acquire(len);
+    buf->assign(data, len);
+    return buf;
+  }
+
+  CoTask<> echo(std::shared_ptr<Loop> loop, std::shared_ptr<Tcp> conn) {
+    CoStream<Tcp> stream{ conn };
+    while (true) {
+      auto r = co_await stream.read();
+      if (r.nread < 0) {
+        break;
+      }
+      if (co_await stream.write(makeBuffer(*loop, r.buf, r.nread)) != 0) {
+        break;
+      }
+    }
+    conn->close();
+  }
+
+  CoTask<std::size_t> roundTrip(CoStream<Tcp> &stream, Loop &loop,
+                                const std::string &msg) {
+    if (co_await stream.write(makeBuffer(loop, msg.data(), msg.size())) != 0) {
+      co_return 0;
+    }
+    std::string reply;
+    while (reply.size() < msg.size()) {
+      auto r = co_await stream.read();
+      if (r.nread < 0) {
+        co_return 0;
+      }
+      reply.append(r.buf, r.nread);
+    }
+    EXPECT_EQ(reply, msg);
+    co_return reply.size();
+  }
+
+  CoTask<> client(std::shared_ptr<Loop> loop, std::shared_ptr<Tcp> server,
+                  uint16_t port, int rounds, std::size_t &echoed) {
+    auto tcp = Tcp::create(loop);
+    CoStream<Tcp> stream{ tcp };
+    auto status = co_await stream.connect("127.0.0.1", port);
+    EXPECT_EQ(status, 0);
+    for (int i = 0; status == 0 && i < rounds; ++i) {
+      echoed += co_await roundTrip(
+        stream, *loop, "message " + std::to_string(i));
+    }
+    tcp->close();
+    server->close();
+  }
+
+  CoTask<> readUntilEof(CoStream<Tcp> &stream,
+                        std::vector<std::string> &events) {
+    while (true) {
+      auto r = co_await stream.read();
+      if (r.nread < 0) {
+        EXPECT_EQ(r.nread, UV_EOF);
+        events.push_back("eof");
+        co_return;
+      }
+    }
+  }
+
+  CoTask<> writeAll(std::shared_ptr<Loop> loop, std::shared_ptr<Tcp> conn,
+                    std::size_t size, const bool &peerReading,
+                    std::vector<std::string> &events) {
+    CoStream<Tcp> stream{ conn };
+    readUntilEof(stream, events).start();
+    std::string data(size, 'x');
+    auto status = co_await stream.write(
+      makeBuffer(*loop, data.data(), data.size()));
+    EXPECT_EQ(status, 0);
+    // more than the socket buffers hold, the write can only complete after
+    // the peer started reading
+    EXPECT_TRUE(peerReading);
+    events.push_back("written");
+    conn->close();
+  }
+}
+
+TEST(Coro, Echo) {
+  const int ROUNDS = 100;
+
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  auto server = Tcp::create(loop, Tcp::Domain::INET);
+  ASSERT_TRUE(!!server);
+  server->on<EvAccept<Tcp>>([&](const auto &e, auto &s) {
+    echo(loop, e.client).start();
+  });
+
+  int on = 1;
+  server->setSockOption(
+    SO_REUSEADDR, reinterpret_cast<void *>(&on), sizeof(on));
+  ASSERT_TRUE(server->bind("127.0.0.1", 22368));
+  ASSERT_TRUE(server->listen(50));
+
+  std::size_t echoed = 0;
+  client(loop, server, 22368, ROUNDS, echoed).start();
+
+  // the frames of the round trips after the first are reused
+  auto misses = CoFramePool::current().getStats().misses;
+  loop->run();
+
+  std::size_t expected = 0;
+  for (int i = 0; i < ROUNDS; ++i) {
+    expected += ("message " + std::to_string(i)).size();
+  }
+  ASSERT_EQ(echoed, expected);
+  ASSERT_LE(CoFramePool::current().getStats().misses, misses + 2);
+}
+
+TEST(Coro, ConnectFailure) {
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  int status = 0;
+  auto connect = [](std::shared_ptr<Loop> loop, int &status) -> CoTask<> {
+    auto tcp = Tcp::create(loop);
+    CoStream<Tcp> stream{ tcp };
+    // nothing listens on it
+    status = co_await stream.connect("127.0.0.1", 22369);
+    // a closed stream fails at once
+    auto r = co_await stream.read();
+    EXPECT_LT(r.nread, 0);
+  };
+  connect(loop, status).start();
+  loop->run();
+
+  ASSERT_EQ(status, UV_ECONNREFUSED);
+}
+
+TEST(Coro, ResolveAndWork) {
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  CoDNSResult dns{ -1, {} };
+  int answer = 0;
+  auto workThread = std::this_thread::get_id();
+  auto thrown = false;
+  auto task = [&]() -> CoTask<> {
+    dns = co_await coResolve(loop, "localhost", true);
+    answer = co_await coWork(loop, [&]() {
+      workThread = std::this_thread::get_id();
+      return 6 * 7;
+    });
+    try {
+      co_await coWork(loop, []() { throw std::runtime_error("job failed"); });
+    } catch (const std::runtime_error &e) {
+      thrown = true;
+    }
+  };
+  // awaited by another task, so the result of the inner one comes back
+  auto outer = [&]() -> CoTask<int> {
+    co_await task();
+    co_return answer + 1;
+  };
+  auto result = 0;
+  [&]() -> CoTask<> {
+    result = co_await outer();
+  }().start();
+  loop->run();
+
+  ASSERT_EQ(dns.status, 0);
+  ASSERT_FALSE(dns.addrs.empty());
+  ASSERT_EQ(dns.addrs[0], "127.0.0.1");
+  ASSERT_EQ(answer, 42);
+  ASSERT_NE(workThread, std::this_thread::get_id());
+  ASSERT_TRUE(thrown);
+  ASSERT_EQ(result, 43);
+}
+
+TEST(Coro, WritePendingDuringHalfClose) {
+  const std::size_t SIZE = 32 * 1024 * 1024;
+
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  auto server = Tcp::create(loop, Tcp::Domain::INET);
+  ASSERT_TRUE(!!server);
+  auto peerReading = false;
+  std::vector<std::string> events;
+  server->on<EvAccept<Tcp>>([&](const auto &e, auto &s) {
+    e.client->setAllowHalfOpen(true);
+    writeAll(loop, e.client, SIZE, peerReading, events).start();
+  });
+
+  int on = 1;
+  server->setSockOption(
+    SO_REUSEADDR, reinterpret_cast<void *>(&on), sizeof(on));
+  ASSERT_TRUE(server->bind("127.0.0.1", 22370));
+  ASSERT_TRUE(server->listen(50));
+
+  // shuts down its writing side at once, and starts reading a bit later
+  auto client = Tcp::create(loop);
+  auto timer = Timer::create(loop);
+  std::size_t received = 0;
+  client->once<EvConnect>([&](const auto &e, auto &c) {
+    c.shutdown();
+    timer->start(200, 0);
+  });
+  timer->on<EvTimer>([&](const auto &e, auto &t) {
+    peerReading = true;
+    client->readStart();
+    t.close();
+  });
+  client->on<EvRead>([&](const auto &e, auto &c) {
+    received += e.nread;
+  });
+  // closed on the EOF after the data
+  client->once<EvClose>([&](const auto &e, auto &c) {
+    server->close();
+  });
+  client->connect("127.0.0.1", 22370);
+
+  loop->run();
+
+  ASSERT_EQ(received, SIZE);
+  ASSERT_EQ(events, (std::vector<std::string>{ "eof", "written" }));
+}
@@ -0,0 +1,257 @@
+#include <gtest/gtest.h>
+#include "uvcpp.h"
+#include <atomic>
+#include <future>
+#include <set>
+
+using namespace uvcpp;
+
+TEST(LoopGroup, StartStop) {
+  LoopGroup group{3};
+  ASSERT_TRUE(group.start());
+  ASSERT_EQ(group.size(), 3);
+
+  std::mutex mutex;
+  std::set<std::thread::id> threadIds;
+  std::atomic<int> count{0};
+  for (std::size_t i = 0; i < group.size(); ++i) {
+    ASSERT_TRUE(group.post(i, [&]{
+      std::lock_guard<std::mutex> lock(mutex);
+      threadIds.insert(std::this_thread::get_id());
+      ++count;
+    }));
+  }
+
+  group.stop();
+  group.join();
+
+  ASSERT_EQ(count, 3);
+  ASSERT_EQ(threadIds.size(), 3);
+  ASSERT_EQ(threadIds.count(std::this_thread::get_id()), 0);
+  ASSERT_FALSE(group.post(0, []{}));
+}
+
+TEST(LoopGroup, DispatchAcceptedClients) {
+  const auto CLIENT_COUNT = 4;
+  std::atomic<int> echoCount{0};
+  auto recvCount = 0;
+
+  LoopGroup group{2};
+  ASSERT_TRUE(group.start());
+
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  auto server = Tcp::create(loop, Tcp::Domain::INET);
+  ASSERT_TRUE(!!server);
+  server->once<EvError>([](const auto &e, auto &tcp) {
+    FAIL() << "server failed with status: " << e.status;
+  });
+
+  server->on<EvAccept<Tcp>>([&](const auto &e, auto &server) {
+    auto client = std::move(const_cast<EvAccept<Tcp> &>(e).client);
+    group.dispatch(std::move(client), [&](const std::shared_ptr<Tcp> &tcp) {
+      // runs on one of the worker loops, echo and close
+      tcp->selfRefUntil<EvClose>();
+      tcp->on<EvRead>([&](const auto &e, auto &tcp) {
+        auto buf = std::make_unique<nul::Buffer>(e.nread);
+        buf->assign(e.buf, e.nread);
+        tcp.writeAsync(std::move(buf));
+        tcp.template once<EvWrite>([&](const auto &e, auto &tcp) {
+          ++echoCount;
+          tcp.close();
+        });
+      });
+      tcp->readStart();
+    });
+  });
+
+  int on = 1;
+  server->setSockOption(
+    SO_REUSEADDR, reinterpret_cast<void *>(&on), sizeof(on));
+  ASSERT_TRUE(server->bind("127.0.0.1", 22335));
+  ASSERT_TRUE(server->listen(50));
+
+  for (int i = 0; i < CLIENT_COUNT; ++i) {
+    auto client = Tcp::create(loop);
+    ASSERT_TRUE(!!client);
+    client->selfRefUntil<EvClose>();
+    client->once<EvConnect>([](const auto &e, auto &client) {
+      auto buf = std::make_unique<nul::Buffer>(5);
+      buf->assign("hello", 5);
+      client.writeAsync(std::move(buf));
+      client.readStart();
+    });
+    client->on<EvRead>([&](const auto &e, auto &client) {
+      ASSERT_EQ(e.nread, 5);
+      client.close();
+      if (++recvCount == CLIENT_COUNT) {
+        server->close();
+      }
+    });
+    ASSERT_TRUE(client->connect("127.0.0.1", 22335));
+  }
+
+  loop->run();
+
+  group.stop();
+  group.join();
+
+  ASSERT_EQ(recvCount, CLIENT_COUNT);
+  ASSERT_EQ(echoCount, CLIENT_COUNT);
+}
+
+TEST(LoopGroup, ListenSharded) {
+  const auto CLIENT_COUNT = 8;
+  std::atomic<int> acceptCount{0};
+  auto recvCount = 0;
+
+  LoopGroup group{2};
+  ASSERT_TRUE(group.start());
+
+  std::mutex mutex;
+  std::vector<std::shared_ptr<Tcp>> listeners;
+  ASSERT_TRUE(group.listenSharded("127.0.0.1", 22336, 50,
+    [&](const std::shared_ptr<Tcp> &server) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        listeners.push_back(server);
+      }
+      server->on<EvAccept<Tcp>>([&](const auto &e, auto &server) {
+        ++acceptCount;
+        e.client->template selfRefUntil<EvClose>();
+        e.client->close();
+      });
+    }));
+  ASSERT_EQ(listeners.size(), 2);
+  ASSERT_NE(listeners[0]->getLoop(), listeners[1]->getLoop());
+
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  for (int i = 0; i < CLIENT_COUNT; ++i) {
+    auto client = Tcp::create(loop);
+    client->selfRefUntil<EvClose>();
+    client->once<EvConnect>([&](const auto &e, auto &client) {
+      client.close();
+      ++recvCount;
+    });
+    ASSERT_TRUE(client->connect("127.0.0.1", 22336));
+  }
+
+  loop->run();
+  ASSERT_EQ(recvCount, CLIENT_COUNT);
+
+  for (int i = 0; i < 200 && acceptCount < CLIENT_COUNT; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  for (std::size_t i = 0; i < group.size(); ++i) {
+    group.post(i, [&listeners, l = group.getLoop(i)]{
+      for (auto &server : listeners) {
+        if (server->getLoop() == l) {
+          server->close();
+        }
+      }
+    });
+  }
+  group.stop();
+  group.join();
+
+  ASSERT_EQ(acceptCount, CLIENT_COUNT);
+}
+
+TEST(LoopGroup, ListenShardedOnStoppedLoops) {
+  LoopGroup group{2};
+  ASSERT_TRUE(group.start());
+
+  // the loops stop on their own, not through stop()
+  for (std::size_t i = 0; i < group.size(); ++i) {
+    ASSERT_TRUE(group.post(i, [l = group.getLoop(i)]{
+      l->setKeepAlive(false);
+      l->stop();
+    }));
+  }
+  group.join();
+
+  // returns instead of waiting for loops that won't run the setup
+  auto setupCount = 0;
+  ASSERT_FALSE(group.listenSharded("127.0.0.1", 22371, 50,
+    [&](const std::shared_ptr<Tcp> &server) {
+      ++setupCount;
+    }));
+  ASSERT_EQ(setupCount, 0);
+  ASSERT_FALSE(group.post(0, []{}));
+}
+
+TEST(LoopGroup, DispatchToStoppingLoop) {
+  LoopGroup group{1};
+  ASSERT_TRUE(group.start());
+
+  // holds the worker loop after it drained its tasks, in the iteration
+  // that ends the loop, so a task posted meanwhile never runs
+  struct Blocker : public Loop::Deferred {
+    virtual void onDeferred() override {
+      started.set_value();
+      release.get_future().wait();
+    }
+    std::promise<void> started;
+    std::promise<void> release;
+  } blocker;
+
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  auto server = Tcp::create(loop, Tcp::Domain::INET);
+  ASSERT_TRUE(!!server);
+  auto dispatched = false;
+  auto called = false;
+  server->on<EvAccept<Tcp>>([&](const auto &e, auto &server) {
+    auto l = group.getLoop(0);
+    ASSERT_TRUE(group.post(0, [l, &blocker]{
+      l->stop();
+      l->defer(&blocker);
+    }));
+    blocker.started.get_future().wait();
+
+    auto client = std::move(const_cast<EvAccept<Tcp> &>(e).client);
+    dispatched = group.dispatch(std::move(client),
+      [&](const std::shared_ptr<Tcp> &tcp) { called = true; });
+    blocker.release.set_value();
+  });
+
+  int on = 1;
+  server->setSockOption(
+    SO_REUSEADDR, reinterpret_cast<void *>(&on), sizeof(on));
+  ASSERT_TRUE(server->bind("127.0.0.1", 22372));
+  ASSERT_TRUE(server->listen(50));
+
+  // the connection ends once the descriptor of the dropped task is closed
+  auto client = Tcp::create(loop);
+  ASSERT_TRUE(!!client);
+  auto closed = false;
+  auto timedOut = false;
+  auto timer = Timer::create(loop);
+  client->once<EvConnect>([](const auto &e, auto &client) {
+    client.readStart();
+  });
+  client->once<EvClose>([&](const auto &e, auto &client) {
+    closed = true;
+    server->close();
+    timer->close();
+  });
+  timer->once<EvTimer>([&](const auto &e, auto &timer) {
+    timedOut = true;
+    client->close();
+  });
+  timer->start(2000, 0);
+  ASSERT_TRUE(client->connect("127.0.0.1", 22372));
+
+  loop->run();
+  group.join();
+
+  ASSERT_TRUE(dispatched);
+  ASSERT_FALSE(called);
+  ASSERT_TRUE(closed);
+  ASSERT_FALSE(timedOut);
+}
@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+#include "uvcpp.h"
+
+using namespace uvcpp;
+
+namespace {
+  // client -> relay server (a) <-> relay upstream (b) -> echo server,
+  // the client half-closes after sending, and expects the echo back
+  // followed by EOF
+  void runEchoThroughRelay(Relay<Tcp>::Mode mode, uint16_t port) {
+    const std::size_t DATA_SIZE = 4 * 1024 * 1024;
+    const uint16_t echoPort = port + 1;
+
+    auto loop = std::make_shared<Loop>();
+    ASSERT_TRUE(loop->init());
+
+    auto echoServer = Tcp::create(loop, Tcp::Domain::INET);
+    auto relayServer = Tcp::create(loop, Tcp::Domain::INET);
+    auto client = Tcp::create(loop);
+    ASSERT_TRUE(!!echoServer);
+    ASSERT_TRUE(!!relayServer);
+    ASSERT_TRUE(!!client);
+
+    echoServer->on<EvAccept<Tcp>>([&](const auto &e, auto &s) {
+      auto conn = e.client;
+      conn->template selfRefUntil<EvClose>();
+      conn->setAllowHalfOpen(true);
+      conn->template on<EvRead>([](const auto &e, auto &conn) {
+        auto buf = std::make_unique<nul::Buffer>(e.nread);
+        buf->assign(e.buf, e.nread);
+        conn.writeAsync(std::move(buf));
+      });
+      conn->template once<EvEnd>([](const auto &e, auto &conn) {
+        conn.template once<EvShutdown>([](const auto &e, auto &conn) {
+          conn.close();
+        });
+        conn.shutdown();
+      });
+      conn->readStart();
+    });
+
+    auto finished = false;
+    auto actualMode = Relay<Tcp>::Mode::COPY;
+    relayServer->on<EvAccept<Tcp>>([&](const auto &e, auto &s) {
+      auto a = e.client;
+      auto b = Tcp::create(loop);
+      b->once<EvConnect>([&, a, b](const auto &e, auto &conn) {
+        auto relay = Relay<Tcp>::create(a, b);
+        relay->setMode(mode);
+        relay->start([&](const auto &relay) {
+          finished = true;
+          actualMode = relay.getMode();
+          ASSERT_EQ(relay.getBytesAToB(), DATA_SIZE);
+          ASSERT_EQ(relay.getBytesBToA(), DATA_SIZE);
+          echoServer->close();
+          relayServer->close();
+        });
+      });
+      b->connect("127.0.0.1", echoPort);
+    });
+
+    std::size_t received = 0;
+    auto sawEnd = false;
+    client->setAllowHalfOpen(true);
+    client->once<EvConnect>([&](const auto &e, auto &client) {
+      auto buf = std::make_unique<nul::Buffer>(DATA_SIZE);
+      memset(buf->getData(), 'r', DATA_SIZE);
+      buf->setLength(DATA_SIZE);
+      client.writeAsync(std::move(buf));
+      client.shutdown();
+      client.readStart();
+    });
+    client->on<EvRead>([&](const auto &e, auto &client) {
+      received += e.nread;
+    });
+    client->once<EvEnd>([&](const auto &e, auto &client) {
+      sawEnd = true;
+      client.close();
+    });
+
+    int on = 1;
+    echoServer->setSockOption(
+      SO_REUSEADDR, reinterpret_cast<void *>(&on), sizeof(on));
+    relayServer->setSockOption(
+      SO_REUSEADDR, reinterpret_cast<void *>(&on), sizeof(on));
+    ASSERT_TRUE(echoServer->bind("127.0.0.1", echoPort));
+    ASSERT_TRUE(echoServer->listen(50));
+    ASSERT_TRUE(relayServer->bind("127.0.0.1", port));
+    ASSERT_TRUE(relayServer->listen(50));
+    ASSERT_TRUE(client->connect("127.0.0.1", port));
+
+    loop->run();
+
+    ASSERT_TRUE(finished);
+    ASSERT_TRUE(sawEnd);
+    ASSERT_EQ(received, DATA_SIZE);
+#ifdef __linux__
+    ASSERT_EQ(actualMode, mode);
+#endif
+  }
+}
+
+TEST(Relay, Copy) {
+  runEchoThroughRelay(Relay<Tcp>::Mode::COPY, 22341);
+}
+
+TEST(Relay, Splice) {
+  runEchoThroughRelay(Relay<Tcp>::Mode::SPLICE, 22343);
+}
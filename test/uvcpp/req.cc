@@ -43,3 +43,42 @@ TEST(Req, DNSRequest0000) {
 
   loop->run();
 }
+
+TEST(Req, ReqQueueRecycles) {
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  auto destroyCount = 0;
+  {
+    auto tcp = Tcp::create(loop);
+    ReqQueue<WriteReq> queue;
+    queue.setMaxFree(2);
+
+    WriteReq *reqs[3];
+    for (auto &r : reqs) {
+      r = queue.acquire(*tcp);
+      r->once<EvDestroy>([&](const auto &e, auto &r) { ++destroyCount; });
+      queue.push(r);
+    }
+    ASSERT_FALSE(queue.empty());
+
+    for (auto &r : reqs) {
+      ASSERT_EQ(queue.pop(), r);
+      queue.release(r);
+    }
+    ASSERT_TRUE(queue.empty());
+    ASSERT_EQ(queue.pop(), nullptr);
+    // only 2 are kept
+    ASSERT_EQ(destroyCount, 1);
+    ASSERT_EQ(queue.getFreeCount(), 2);
+
+    // most recently released first
+    ASSERT_EQ(queue.acquire(*tcp), reqs[1]);
+    ASSERT_EQ(queue.getFreeCount(), 1);
+    queue.push(reqs[1]);
+    tcp->selfRefUntil<EvClose>();
+    tcp->close();
+  }
+  ASSERT_EQ(destroyCount, 3);
+  loop->run();
+}
@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include "uvcpp.h"
+#include <array>
+
+using namespace uvcpp;
+
+struct EvTest : public Event {
+  EvTest(int value) : value(value) { }
+  int value;
+};
+struct EvOther : public Event { };
+
+TEST(Resource, OnAndOnce) {
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  auto prepare = Prepare::create(loop);
+  ASSERT_TRUE(!!prepare);
+
+  auto onSum = 0;
+  auto onceSum = 0;
+  prepare->on<EvTest>([&onSum](const auto &e, auto &p) {
+    onSum += e.value;
+  });
+  prepare->once<EvTest>([&onceSum](const auto &e, auto &p) {
+    onceSum += e.value;
+  });
+  prepare->once<EvTest>([&onceSum](const auto &e, auto &p) {
+    onceSum += e.value * 10;
+  });
+
+  prepare->publish(EvTest{ 1 });
+  prepare->publish(EvTest{ 2 });
+
+  ASSERT_EQ(onSum, 3);
+  ASSERT_EQ(onceSum, 11);
+
+  prepare->close();
+  loop->run();
+}
+
+TEST(Resource, RegisterWhileDispatching) {
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  auto prepare = Prepare::create(loop);
+  ASSERT_TRUE(!!prepare);
+
+  // large captures don't fit in the inline storage and go to the heap
+  std::array<int, 64> big{};
+  big[63] = 7;
+
+  auto count = 0;
+  auto otherCount = 0;
+  auto onceCount = 0;
+  prepare->on<EvTest>([&, big](const auto &e, auto &p) {
+    ++count;
+    // 'on' callbacks registered here are not called in the current
+    // dispatch, and growing the storage must not move this running callback
+    p.template on<EvTest>([&](const auto &e, auto &p) { ++count; });
+    p.template on<EvOther>([&](const auto &e, auto &p) { ++otherCount; });
+    p.template once<EvTest>([&](const auto &e, auto &p) { ++onceCount; });
+    ASSERT_EQ(big[63], 7);
+  });
+
+  // 'once' callbacks are called after the 'on' ones of the same publish
+  prepare->publish(EvTest{ 0 });
+  ASSERT_EQ(count, 1);
+  ASSERT_EQ(onceCount, 1);
+
+  prepare->publish(EvTest{ 0 });
+  ASSERT_EQ(count, 3);
+  ASSERT_EQ(onceCount, 2);
+
+  prepare->publish(EvOther{});
+  ASSERT_EQ(otherCount, 2);
+
+  prepare->close();
+  loop->run();
+}
+
+TEST(Resource, OnceReleasesSelfRef) {
+  auto destroyed = false;
+  {
+    auto loop = std::make_shared<Loop>();
+    ASSERT_TRUE(loop->init());
+
+    auto prepare = Prepare::create(loop);
+    prepare->selfRefUntil<EvClose>();
+    prepare->once<EvDestroy>([&destroyed](const auto &e, auto &p) {
+      destroyed = true;
+    });
+    prepare->close();
+    prepare.reset();
+
+    loop->run();
+  }
+  ASSERT_TRUE(destroyed);
+}
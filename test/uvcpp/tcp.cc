@@ -180,3 +180,802 @@ TEST(Tcp, ImmediateClose) {
 
   loop->run();
 }
+
+std::unique_ptr<nul::Buffer> makeBuffer(const std::string &s) {
+  auto buf = std::make_unique<nul::Buffer>(s.size());
+  buf->assign(s.c_str(), s.size());
+  return buf;
+}
+
+TEST(Tcp, WritevAndCork) {
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  auto server = Tcp::create(loop, Tcp::Domain::INET);
+  auto client = Tcp::create(loop);
+  ASSERT_TRUE(!!server);
+  ASSERT_TRUE(!!client);
+
+  auto recycledCount = 0;
+  auto writeCount = 0;
+  client->on<EvBufferRecycled>([&](const auto &e, auto &client) {
+    ++recycledCount;
+  });
+  client->on<EvWrite>([&](const auto &e, auto &client) {
+    ++writeCount;
+  });
+
+  client->once<EvConnect>([&](const auto &e, auto &client) {
+    std::vector<std::unique_ptr<nul::Buffer>> bufs;
+    bufs.push_back(makeBuffer("head"));
+    bufs.push_back(makeBuffer("body"));
+    ASSERT_TRUE(client.writev(std::move(bufs)));
+
+    // the following 4 buffers go out with a single uv_write
+    client.setCork(true);
+    ASSERT_TRUE(client.writeAsync(makeBuffer("a")));
+    ASSERT_TRUE(client.writeAsync(makeBuffer("b")));
+    bufs.clear();
+    bufs.push_back(makeBuffer("c"));
+    bufs.push_back(makeBuffer("d"));
+    ASSERT_TRUE(client.writev(std::move(bufs)));
+  });
+
+  std::string received;
+  std::shared_ptr<Tcp> acceptedClient;
+  server->on<EvAccept<Tcp>>([&](const auto &e, auto &s) {
+    e.client->template on<EvRead>([&](const auto &e, auto &c){
+      received.append(e.buf, e.nread);
+      if (received.size() == 12) {
+        c.close();
+        s.close();
+        client->close();
+      }
+    });
+    e.client->readStart();
+    acceptedClient = std::move(const_cast<EvAccept<Tcp> &>(e).client);
+  });
+
+  int on = 1;
+  server->setSockOption(
+    SO_REUSEADDR, reinterpret_cast<void *>(&on), sizeof(on));
+  ASSERT_TRUE(server->bind("127.0.0.1", 22337));
+  ASSERT_TRUE(server->listen(50));
+  ASSERT_TRUE(client->connect("127.0.0.1", 22337));
+
+  loop->run();
+
+  ASSERT_EQ(received, "headbodyabcd");
+  ASSERT_EQ(recycledCount, 6);
+  ASSERT_EQ(writeCount, 2);
+}
+
+TEST(Tcp, WriteWatermarks) {
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  auto server = Tcp::create(loop, Tcp::Domain::INET);
+  auto client = Tcp::create(loop);
+  ASSERT_TRUE(!!server);
+  ASSERT_TRUE(!!client);
+
+  auto fullCount = 0;
+  auto drainedCount = 0;
+  client->setWriteWatermarks(8, 4);
+  client->on<EvWriteQueueFull>([&](const auto &e, auto &client) {
+    ++fullCount;
+    ASSERT_EQ(e.queuedBytes, 9);
+    ASSERT_TRUE(client.isWriteQueueFull());
+  });
+  client->on<EvWriteQueueDrained>([&](const auto &e, auto &client) {
+    ++drainedCount;
+    ASSERT_LE(e.queuedBytes, 4);
+    ASSERT_FALSE(client.isWriteQueueFull());
+  });
+
+  client->once<EvConnect>([&](const auto &e, auto &client) {
+    ASSERT_TRUE(client.writeAsync(makeBuffer("abc")));
+    ASSERT_EQ(client.getWriteQueueSize(), 3);
+    // corked bytes count as well
+    client.setCork(true);
+    ASSERT_TRUE(client.writeAsync(makeBuffer("def")));
+    ASSERT_EQ(fullCount, 0);
+    ASSERT_TRUE(client.writeAsync(makeBuffer("ghi")));
+    ASSERT_EQ(fullCount, 1);
+    ASSERT_EQ(client.getWriteQueueSize(), 9);
+    client.setCork(false);
+    ASSERT_EQ(client.getWriteQueueSize(), 9);
+  });
+
+  std::string received;
+  std::shared_ptr<Tcp> acceptedClient;
+  server->on<EvAccept<Tcp>>([&](const auto &e, auto &s) {
+    // not a real relay, the reader is paused/resumed along with the queue
+    client->pauseReadingWhileFull(e.client);
+    e.client->template on<EvRead>([&](const auto &e, auto &c){
+      received.append(e.buf, e.nread);
+      if (received.size() == 9) {
+        c.close();
+        s.close();
+        client->close();
+      }
+    });
+    e.client->readStart();
+    acceptedClient = std::move(const_cast<EvAccept<Tcp> &>(e).client);
+  });
+
+  int on = 1;
+  server->setSockOption(
+    SO_REUSEADDR, reinterpret_cast<void *>(&on), sizeof(on));
+  ASSERT_TRUE(server->bind("127.0.0.1", 22339));
+  ASSERT_TRUE(server->listen(50));
+  ASSERT_TRUE(client->connect("127.0.0.1", 22339));
+
+  loop->run();
+
+  ASSERT_EQ(received, "abcdefghi");
+  ASSERT_EQ(fullCount, 1);
+  ASSERT_EQ(drainedCount, 1);
+  ASSERT_EQ(client->getWriteQueueSize(), 0);
+}
+
+TEST(Tcp, TryWrite) {
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  auto server = Tcp::create(loop, Tcp::Domain::INET);
+  auto client = Tcp::create(loop);
+  ASSERT_TRUE(!!server);
+  ASSERT_TRUE(!!client);
+
+  // large enough not to fit in the socket buffer, so its tail is queued
+  const std::size_t LARGE_SIZE = 16 * 1024 * 1024;
+  auto recycledCount = 0;
+  auto writeCount = 0;
+  client->on<EvBufferRecycled>([&](const auto &e, auto &client) {
+    ++recycledCount;
+  });
+  client->on<EvWrite>([&](const auto &e, auto &client) {
+    ++writeCount;
+  });
+
+  client->once<EvConnect>([&](const auto &e, auto &client) {
+    ASSERT_TRUE(client.tryWrite(makeBuffer("hello")));
+    // written at once
+    ASSERT_EQ(recycledCount, 1);
+    ASSERT_EQ(writeCount, 1);
+    ASSERT_EQ(client.getWriteQueueSize(), 0);
+
+    auto buf = std::make_unique<nul::Buffer>(LARGE_SIZE);
+    memset(buf->getData(), 'x', LARGE_SIZE);
+    buf->setLength(LARGE_SIZE);
+    ASSERT_TRUE(client.tryWrite(std::move(buf)));
+    ASSERT_EQ(writeCount, 1);
+    ASSERT_GT(client.getWriteQueueSize(), 0);
+    ASSERT_LT(client.getWriteQueueSize(), LARGE_SIZE);
+  });
+
+  std::size_t receivedSize = 0;
+  std::string head;
+  std::shared_ptr<Tcp> acceptedClient;
+  server->on<EvAccept<Tcp>>([&](const auto &e, auto &s) {
+    e.client->template on<EvRead>([&](const auto &e, auto &c){
+      if (head.size() < 5) {
+        head.append(e.buf, std::min<std::size_t>(e.nread, 5 - head.size()));
+      }
+      receivedSize += e.nread;
+      if (receivedSize == LARGE_SIZE + 5) {
+        c.close();
+        s.close();
+        client->close();
+      }
+    });
+    e.client->readStart();
+    acceptedClient = std::move(const_cast<EvAccept<Tcp> &>(e).client);
+  });
+
+  int on = 1;
+  server->setSockOption(
+    SO_REUSEADDR, reinterpret_cast<void *>(&on), sizeof(on));
+  ASSERT_TRUE(server->bind("127.0.0.1", 22340));
+  ASSERT_TRUE(server->listen(50));
+  ASSERT_TRUE(client->connect("127.0.0.1", 22340));
+
+  loop->run();
+
+  ASSERT_EQ(head, "hello");
+  ASSERT_EQ(receivedSize, LARGE_SIZE + 5);
+  ASSERT_EQ(recycledCount, 2);
+  ASSERT_EQ(writeCount, 2);
+}
+
+namespace {
+  std::string makeTempFile(std::size_t size) {
+    char path[] = "/tmp/uvcpp_sendfile_XXXXXX";
+    auto fd = mkstemp(path);
+    std::string content(size, 0);
+    for (std::size_t i = 0; i < size; ++i) {
+      content[i] = static_cast<char>(i % 251);
+    }
+    auto n = write(fd, content.data(), size);
+    close(fd);
+    return n == static_cast<ssize_t>(size) ? path : "";
+  }
+}
+
+TEST(Tcp, SendFile) {
+  const std::size_t FILE_SIZE = 3 * 1024 * 1024 + 7;
+  auto path = makeTempFile(FILE_SIZE);
+  ASSERT_FALSE(path.empty());
+  auto fd = open(path.c_str(), O_RDONLY);
+  ASSERT_NE(fd, -1);
+
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  auto server = Tcp::create(loop, Tcp::Domain::INET);
+  auto client = Tcp::create(loop);
+  ASSERT_TRUE(!!server);
+  ASSERT_TRUE(!!client);
+
+  auto progressCount = 0;
+  std::vector<int> statuses;
+  std::vector<std::size_t> sents;
+  client->on<EvSendFileProgress>([&](const auto &e, auto &client) {
+    ++progressCount;
+  });
+  client->on<EvSendFileFinish>([&](const auto &e, auto &client) {
+    statuses.push_back(e.status);
+    sents.push_back(e.sent);
+    if (statuses.size() == 1) {
+      ASSERT_FALSE(client.isSendingFile());
+      ASSERT_TRUE(client.sendFile("/nonexistent/uvcpp_file"));
+    } else if (statuses.size() == 2) {
+      ASSERT_TRUE(client.sendFile(fd, 10, 100));
+    } else {
+      // the peer may have all the bytes before the chunk completes
+      client.close();
+    }
+  });
+
+  client->once<EvConnect>([&](const auto &e, auto &client) {
+    // small enough for sendfile to hit EAGAIN
+    int size = 64 * 1024;
+    client.setSockOption(SO_SNDBUF, &size, sizeof(size));
+    // goes out before the file
+    ASSERT_TRUE(client.writeAsync(makeBuffer("head")));
+    ASSERT_TRUE(client.sendFile(path));
+    ASSERT_TRUE(client.isSendingFile());
+    ASSERT_FALSE(client.sendFile(path));
+  });
+
+  std::string received;
+  std::shared_ptr<Tcp> acceptedClient;
+  auto timer = Timer::create(loop);
+  server->on<EvAccept<Tcp>>([&](const auto &e, auto &s) {
+    e.client->template on<EvRead>([&](const auto &e, auto &c){
+      received.append(e.buf, e.nread);
+      if (received.size() == 4 + FILE_SIZE + 100) {
+        c.close();
+        s.close();
+      }
+    });
+    acceptedClient = std::move(const_cast<EvAccept<Tcp> &>(e).client);
+    int size = 64 * 1024;
+    acceptedClient->setSockOption(SO_RCVBUF, &size, sizeof(size));
+    // let the socket buffers fill up, so that sendfile hits EAGAIN
+    timer->once<EvTimer>([&](const auto &e, auto &timer) {
+      acceptedClient->readStart();
+      timer.close();
+    });
+    timer->start(50, 0);
+  });
+
+  int on = 1;
+  server->setSockOption(
+    SO_REUSEADDR, reinterpret_cast<void *>(&on), sizeof(on));
+  ASSERT_TRUE(server->bind("127.0.0.1", 22350));
+  ASSERT_TRUE(server->listen(50));
+  ASSERT_TRUE(client->connect("127.0.0.1", 22350));
+
+  loop->run();
+  close(fd);
+
+  ASSERT_EQ(statuses.size(), 3);
+  ASSERT_EQ(statuses[0], 0);
+  ASSERT_EQ(sents[0], FILE_SIZE);
+  ASSERT_EQ(statuses[1], UV_ENOENT);
+  ASSERT_EQ(sents[1], 0);
+  ASSERT_EQ(statuses[2], 0);
+  ASSERT_EQ(sents[2], 100);
+  ASSERT_GE(progressCount, 2);
+
+  ASSERT_EQ(received.size(), 4 + FILE_SIZE + 100);
+  ASSERT_EQ(received.substr(0, 4), "head");
+  for (std::size_t i = 0; i < FILE_SIZE; ++i) {
+    ASSERT_EQ(received[4 + i], static_cast<char>(i % 251));
+  }
+  for (std::size_t i = 0; i < 100; ++i) {
+    ASSERT_EQ(received[4 + FILE_SIZE + i], static_cast<char>((i + 10) % 251));
+  }
+  unlink(path.c_str());
+}
+
+TEST(Tcp, SendFileCancelledByClose) {
+  auto path = makeTempFile(1024 * 1024);
+  ASSERT_FALSE(path.empty());
+
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  auto server = Tcp::create(loop, Tcp::Domain::INET);
+  auto client = Tcp::create(loop);
+  ASSERT_TRUE(!!server);
+  ASSERT_TRUE(!!client);
+
+  auto status = 0;
+  client->on<EvSendFileFinish>([&](const auto &e, auto &client) {
+    status = e.status;
+  });
+  server->on<EvAccept<Tcp>>([&](const auto &e, auto &s) {
+    e.client->template selfRefUntil<EvClose>();
+    e.client->close();
+  });
+  client->once<EvConnect>([&](const auto &e, auto &client) {
+    ASSERT_TRUE(client.sendFile(path));
+    client.close();
+    server->close();
+  });
+
+  int on = 1;
+  server->setSockOption(
+    SO_REUSEADDR, reinterpret_cast<void *>(&on), sizeof(on));
+  ASSERT_TRUE(server->bind("127.0.0.1", 22351));
+  ASSERT_TRUE(server->listen(50));
+  ASSERT_TRUE(client->connect("127.0.0.1", 22351));
+
+  loop->run();
+
+  ASSERT_EQ(status, UV_ECANCELED);
+  unlink(path.c_str());
+}
+
+TEST(Tcp, OwnedReadBuffers) {
+  const std::size_t DATA_SIZE = 1024 * 1024;
+
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  auto server = Tcp::create(loop, Tcp::Domain::INET);
+  auto client = Tcp::create(loop);
+  ASSERT_TRUE(!!server);
+  ASSERT_TRUE(!!client);
+
+  // the server echoes the buffers it reads into without copying
+  server->on<EvAccept<Tcp>>([&](const auto &e, auto &s) {
+    auto conn = e.client;
+    conn->template selfRefUntil<EvClose>();
+    conn->setOwnedReadBuffers(16 * 1024);
+    conn->template on<EvRead>([](const auto &e, auto &conn) {
+      ASSERT_TRUE(!!e.buffer);
+      ASSERT_EQ(e.buffer->getData(), e.buf);
+      ASSERT_EQ(e.buffer->getLength(), e.nread);
+      conn.writeAsync(std::move(e.buffer));
+    });
+    conn->template once<EvEnd>([](const auto &e, auto &conn) {
+      conn.close();
+    });
+    conn->readStart();
+  });
+
+  // the client never takes its buffers, so one buffer serves all reads
+  auto allocated = 0;
+  std::string received;
+  client->setReadBufferAllocator([&](std::size_t size) {
+    ++allocated;
+    return std::make_unique<nul::Buffer>(size);
+  });
+  client->on<EvRead>([&](const auto &e, auto &client) {
+    ASSERT_TRUE(!!e.buffer);
+    received.append(e.buf, e.nread);
+    if (received.size() == DATA_SIZE) {
+      client.close();
+      server->close();
+    }
+  });
+  client->once<EvConnect>([&](const auto &e, auto &client) {
+    auto buf = std::make_unique<nul::Buffer>(DATA_SIZE);
+    for (std::size_t i = 0; i < DATA_SIZE; ++i) {
+      buf->getData()[i] = static_cast<char>(i % 251);
+    }
+    buf->setLength(DATA_SIZE);
+    client.writeAsync(std::move(buf));
+    client.readStart();
+  });
+
+  int on = 1;
+  server->setSockOption(
+    SO_REUSEADDR, reinterpret_cast<void *>(&on), sizeof(on));
+  ASSERT_TRUE(server->bind("127.0.0.1", 22352));
+  ASSERT_TRUE(server->listen(50));
+  ASSERT_TRUE(client->connect("127.0.0.1", 22352));
+
+  loop->run();
+
+  ASSERT_EQ(allocated, 1);
+  ASSERT_EQ(received.size(), DATA_SIZE);
+  for (std::size_t i = 0; i < DATA_SIZE; ++i) {
+    ASSERT_EQ(received[i], static_cast<char>(i % 251));
+  }
+}
+
+TEST(Tcp, AdaptiveReadBuffers) {
+  const std::size_t BULK_SIZE = 4 * 1024 * 1024;
+  const std::size_t MAX_READ_SIZE = 64 * 1024;
+  const int PINGS = 8;
+
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  auto server = Tcp::create(loop, Tcp::Domain::INET);
+  auto client = Tcp::create(loop);
+  ASSERT_TRUE(!!server);
+  ASSERT_TRUE(!!client);
+
+  // the server takes a bulk transfer, then answers small pings one by one
+  std::size_t received = 0;
+  std::size_t largestRead = 0;
+  std::size_t lastReadSize = 0;
+  Tcp::ReadStats stats;
+  server->on<EvAccept<Tcp>>([&](const auto &e, auto &s) {
+    auto conn = e.client;
+    conn->template selfRefUntil<EvClose>();
+    conn->setAdaptiveReadBuffers(64, 4096, MAX_READ_SIZE);
+    conn->template on<EvRead>([&](const auto &e, auto &conn) {
+      lastReadSize = e.buffer->getCapacity();
+      if (lastReadSize > largestRead) {
+        largestRead = lastReadSize;
+      }
+      received += e.nread;
+      // one reply per ping, the read ending the bulk transfer may carry
+      // much more than the ping, which the client might get in pieces
+      if (received >= BULK_SIZE) {
+        auto reply = std::make_unique<nul::Buffer>(4);
+        reply->assign("pong", 4);
+        conn.writeAsync(std::move(reply));
+      }
+    });
+    conn->template once<EvClose>([&](const auto &e, auto &conn) {
+      stats = conn.getReadStats();
+    });
+    conn->readStart();
+  });
+
+  auto pings = 0;
+  auto ping = [](Tcp &client) {
+    auto buf = std::make_unique<nul::Buffer>(10);
+    buf->assign("0123456789", 10);
+    client.writeAsync(std::move(buf));
+  };
+  client->on<EvRead>([&](const auto &e, auto &client) {
+    if (++pings < PINGS) {
+      ping(client);
+    } else {
+      client.close();
+      server->close();
+    }
+  });
+  client->once<EvConnect>([&](const auto &e, auto &client) {
+    auto buf = std::make_unique<nul::Buffer>(BULK_SIZE - 10);
+    memset(buf->getData(), 'b', BULK_SIZE - 10);
+    buf->setLength(BULK_SIZE - 10);
+    client.writeAsync(std::move(buf));
+    ping(client);
+    client.readStart();
+  });
+
+  int on = 1;
+  server->setSockOption(
+    SO_REUSEADDR, reinterpret_cast<void *>(&on), sizeof(on));
+  ASSERT_TRUE(server->bind("127.0.0.1", 22353));
+  ASSERT_TRUE(server->listen(50));
+  ASSERT_TRUE(client->connect("127.0.0.1", 22353));
+
+  loop->run();
+
+  ASSERT_EQ(received, BULK_SIZE + (PINGS - 1) * 10);
+  ASSERT_EQ(largestRead, MAX_READ_SIZE);
+  // grown early on, the bulk transfer took a fraction of 4 KB reads
+  ASSERT_LT(stats.reads, BULK_SIZE / 4096 / 4);
+  ASSERT_EQ(stats.bytes, received);
+  ASSERT_GT(stats.fullReads, 0);
+  // halved every two pings
+  ASSERT_LE(lastReadSize, MAX_READ_SIZE / 4);
+}
+
+TEST(Tcp, ReadTimeout) {
+  const uint64_t READ_TIMEOUT = 200;
+
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  auto server = Tcp::create(loop, Tcp::Domain::INET);
+  auto client = Tcp::create(loop);
+  ASSERT_TRUE(!!server);
+  ASSERT_TRUE(!!client);
+
+  // reads keep the connection alive, it is closed once they stop
+  auto reads = 0;
+  uint64_t lastReadAt = 0;
+  uint64_t timedOutAt = 0;
+  server->on<EvAccept<Tcp>>([&](const auto &e, auto &s) {
+    auto conn = e.client;
+    conn->template selfRefUntil<EvClose>();
+    conn->setReadTimeout(READ_TIMEOUT);
+    conn->template on<EvRead>([&](const auto &e, auto &conn) {
+      ++reads;
+      lastReadAt = uv_now(loop->getRaw());
+    });
+    conn->template on<EvTimeout>([&](const auto &e, auto &conn) {
+      ASSERT_EQ(e.kind, EvTimeout::Kind::READ);
+      timedOutAt = uv_now(loop->getRaw());
+    });
+    conn->readStart();
+  });
+
+  auto timer = Timer::create(loop);
+  auto writes = 0;
+  timer->on<EvTimer>([&](const auto &e, auto &timer) {
+    auto buf = std::make_unique<nul::Buffer>(4);
+    buf->assign("ping", 4);
+    client->writeAsync(std::move(buf));
+    if (++writes == 3) {
+      timer.close();
+    }
+  });
+  client->once<EvConnect>([&](const auto &e, auto &client) {
+    timer->start(READ_TIMEOUT / 2, READ_TIMEOUT / 2);
+    client.readStart();
+  });
+  client->once<EvClose>([&](const auto &e, auto &client) {
+    server->close();
+  });
+
+  int on = 1;
+  server->setSockOption(
+    SO_REUSEADDR, reinterpret_cast<void *>(&on), sizeof(on));
+  ASSERT_TRUE(server->bind("127.0.0.1", 22364));
+  ASSERT_TRUE(server->listen(50));
+  ASSERT_TRUE(client->connect("127.0.0.1", 22364));
+
+  loop->run();
+
+  ASSERT_EQ(reads, 3);
+  ASSERT_GE(timedOutAt - lastReadAt, READ_TIMEOUT);
+  ASSERT_LT(timedOutAt - lastReadAt, READ_TIMEOUT + 500);
+}
+
+TEST(Tcp, LifetimeAndKeptOpenTimeouts) {
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  auto server = Tcp::create(loop, Tcp::Domain::INET);
+  auto client = Tcp::create(loop);
+  ASSERT_TRUE(!!server);
+  ASSERT_TRUE(!!client);
+
+  server->on<EvAccept<Tcp>>([&](const auto &e, auto &s) {
+    auto conn = e.client;
+    conn->template selfRefUntil<EvClose>();
+    conn->template once<EvEnd>([](const auto &e, auto &conn) {
+      conn.close();
+    });
+    conn->setAllowHalfOpen(true);
+    conn->readStart();
+  });
+
+  // nothing is ever read, the read timeouts are kept open until the
+  // lifetime runs out
+  auto readTimeouts = 0;
+  auto lifetimeTimeouts = 0;
+  client->on<EvTimeout>([&](const auto &e, auto &client) {
+    if (e.kind == EvTimeout::Kind::READ) {
+      ++readTimeouts;
+      e.close = false;
+    } else {
+      ASSERT_EQ(e.kind, EvTimeout::Kind::LIFETIME);
+      ++lifetimeTimeouts;
+    }
+  });
+  client->once<EvConnect>([&](const auto &e, auto &client) {
+    client.setReadTimeout(100);
+    client.setLifetime(450);
+    client.readStart();
+  });
+  client->once<EvClose>([&](const auto &e, auto &client) {
+    server->close();
+  });
+
+  int on = 1;
+  server->setSockOption(
+    SO_REUSEADDR, reinterpret_cast<void *>(&on), sizeof(on));
+  ASSERT_TRUE(server->bind("127.0.0.1", 22365));
+  ASSERT_TRUE(server->listen(50));
+  ASSERT_TRUE(client->connect("127.0.0.1", 22365));
+
+  loop->run();
+
+  ASSERT_GE(readTimeouts, 2);
+  ASSERT_LE(readTimeouts, 4);
+  ASSERT_EQ(lifetimeTimeouts, 1);
+}
+
+TEST(Tcp, WriteTimeout) {
+  const std::size_t DATA_SIZE = 64 * 1024 * 1024;
+
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  auto server = Tcp::create(loop, Tcp::Domain::INET);
+  auto client = Tcp::create(loop);
+  ASSERT_TRUE(!!server);
+  ASSERT_TRUE(!!client);
+
+  // the server never reads, so the write stalls once the socket buffers
+  // are full
+  std::shared_ptr<Tcp> conn;
+  server->on<EvAccept<Tcp>>([&](const auto &e, auto &s) {
+    conn = e.client;
+  });
+
+  auto writeTimeouts = 0;
+  client->on<EvTimeout>([&](const auto &e, auto &client) {
+    ASSERT_EQ(e.kind, EvTimeout::Kind::WRITE);
+    ++writeTimeouts;
+  });
+  client->once<EvConnect>([&](const auto &e, auto &client) {
+    client.setWriteTimeout(200);
+    auto buf = std::make_unique<nul::Buffer>(DATA_SIZE);
+    buf->setLength(DATA_SIZE);
+    client.writeAsync(std::move(buf));
+  });
+  client->once<EvClose>([&](const auto &e, auto &client) {
+    if (conn) {
+      conn->close();
+    }
+    server->close();
+  });
+
+  int on = 1;
+  server->setSockOption(
+    SO_REUSEADDR, reinterpret_cast<void *>(&on), sizeof(on));
+  ASSERT_TRUE(server->bind("127.0.0.1", 22366));
+  ASSERT_TRUE(server->listen(50));
+  ASSERT_TRUE(client->connect("127.0.0.1", 22366));
+
+  loop->run();
+
+  ASSERT_EQ(writeTimeouts, 1);
+}
+
+TEST(Tcp, ConnectTimeout) {
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  // a listener that never accepts, with a backlog of 0 on Linux the queue
+  // takes one connection and the handshakes of later ones are left hanging
+  auto fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_GE(fd, 0);
+  int on = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  SockAddrStorage sas;
+  ASSERT_TRUE(NetUtil::convertIPAddress("127.0.0.1", 22367, &sas));
+  ASSERT_EQ(::bind(fd, reinterpret_cast<SockAddr *>(&sas), sizeof(SockAddr4)), 0);
+  ASSERT_EQ(::listen(fd, 0), 0);
+
+  auto first = Tcp::create(loop);
+  auto client = Tcp::create(loop);
+  ASSERT_TRUE(!!first);
+  ASSERT_TRUE(!!client);
+
+  auto connectTimeouts = 0;
+  auto connected = false;
+  client->on<EvTimeout>([&](const auto &e, auto &client) {
+    ASSERT_EQ(e.kind, EvTimeout::Kind::CONNECT);
+    ++connectTimeouts;
+  });
+  client->on<EvConnect>([&](const auto &e, auto &client) {
+    connected = true;
+  });
+  client->once<EvClose>([&](const auto &e, auto &client) {
+    first->close();
+  });
+  first->once<EvConnect>([&](const auto &e, auto &first) {
+    client->setConnectTimeout(200);
+    ASSERT_TRUE(client->connect("127.0.0.1", 22367));
+  });
+  ASSERT_TRUE(first->connect("127.0.0.1", 22367));
+
+  auto start = uv_now(loop->getRaw());
+  loop->run();
+  ::close(fd);
+
+  ASSERT_EQ(connectTimeouts, 1);
+  ASSERT_FALSE(connected);
+  ASSERT_LT(uv_now(loop->getRaw()) - start, 1000);
+}
+
+#ifdef UVCPP_STREAM_SHARED_READ_BUF
+// built into tcp_shared_read_buf only, along with all the tests above
+TEST(Tcp, SharedReadBuffer) {
+  const std::size_t SIZE = 1024 * 1024;
+  const char PATTERNS[] = { 'a', 'b' };
+
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  auto server = Tcp::create(loop, Tcp::Domain::INET);
+  ASSERT_TRUE(!!server);
+
+  // the reads of both connections go to the one buffer of the loop, each
+  // listener sees its own data, also after reading again from within the
+  // listener, before the data is consumed
+  auto shared = loop->getSharedReadBuffer();
+  std::size_t received[2] = { 0, 0 };
+  auto reads = 0;
+  auto closedCount = 0;
+  server->on<EvAccept<Tcp>>([&](const auto &e, auto &s) {
+    auto conn = e.client;
+    conn->template selfRefUntil<EvClose>();
+    conn->template on<EvRead>([&](const auto &e, auto &conn) {
+      ASSERT_EQ(e.buf, shared.base);
+      ASSERT_FALSE(e.buffer);
+      if (++reads % 2 == 0) {
+        conn.readStop();
+        conn.readStart();
+      }
+      auto index = e.buf[0] - PATTERNS[0];
+      ASSERT_TRUE(index == 0 || index == 1);
+      for (ssize_t i = 0; i < e.nread; ++i) {
+        ASSERT_EQ(e.buf[i], PATTERNS[index]);
+      }
+      received[index] += e.nread;
+    });
+    conn->template once<EvClose>([&](const auto &e, auto &conn) {
+      if (++closedCount == 2) {
+        server->close();
+      }
+    });
+    conn->readStart();
+  });
+
+  int on = 1;
+  server->setSockOption(
+    SO_REUSEADDR, reinterpret_cast<void *>(&on), sizeof(on));
+  ASSERT_TRUE(server->bind("127.0.0.1", 22373));
+  ASSERT_TRUE(server->listen(50));
+
+  // both send at once, and close when done, which ends the connections
+  for (auto pattern : PATTERNS) {
+    auto client = Tcp::create(loop);
+    ASSERT_TRUE(!!client);
+    client->selfRefUntil<EvClose>();
+    client->once<EvConnect>([&, pattern](const auto &e, auto &client) {
+      auto buf = std::make_unique<nul::Buffer>(SIZE);
+      memset(buf->getData(), pattern, SIZE);
+      buf->setLength(SIZE);
+      client.writeAsync(std::move(buf));
+    });
+    client->once<EvWrite>([](const auto &e, auto &client) {
+      client.close();
+    });
+    ASSERT_TRUE(client->connect("127.0.0.1", 22373));
+  }
+
+  loop->run();
+
+  ASSERT_EQ(received[0], SIZE);
+  ASSERT_EQ(received[1], SIZE);
+  ASSERT_GT(reads, 2);
+}
+#endif
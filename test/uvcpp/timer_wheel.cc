@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+#include "uvcpp.h"
+#include <vector>
+#include <algorithm>
+
+using namespace uvcpp;
+
+namespace {
+  struct TestEntry : public TimerWheel::Entry {
+    TestEntry(int id, std::vector<int> &fired, Loop &loop) :
+      id(id), fired(fired), loop(loop) { }
+
+    virtual void onTimeout() override {
+      fired.push_back(id);
+      firedAt = uv_now(loop.getRaw());
+      if (then) {
+        then();
+      }
+    }
+
+    int id;
+    std::vector<int> &fired;
+    Loop &loop;
+    uint64_t firedAt{0};
+    std::function<void()> then;
+  };
+}
+
+TEST(TimerWheel, Order) {
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  std::vector<int> fired;
+  TimerWheel wheel(loop->getRaw());
+  // the last two go through the second level of the wheel
+  const uint64_t timeouts[] = { 30, 1, 10, 0, 150, 70 };
+  std::vector<std::unique_ptr<TestEntry>> entries;
+  auto start = uv_now(loop->getRaw());
+  for (auto i = 0u; i < sizeof(timeouts) / sizeof(timeouts[0]); ++i) {
+    entries.push_back(std::make_unique<TestEntry>(i, fired, *loop));
+    wheel.schedule(entries.back().get(), timeouts[i]);
+    ASSERT_TRUE(entries.back()->isScheduled());
+  }
+  ASSERT_EQ(wheel.size(), entries.size());
+
+  loop->run();
+
+  ASSERT_EQ(fired, (std::vector<int>{ 3, 1, 2, 0, 5, 4 }));
+  ASSERT_EQ(wheel.size(), 0);
+  for (auto i = 0u; i < entries.size(); ++i) {
+    ASSERT_FALSE(entries[i]->isScheduled());
+    ASSERT_GE(entries[i]->firedAt - start, timeouts[i]);
+  }
+}
+
+TEST(TimerWheel, ResetAndCancel) {
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  std::vector<int> fired;
+  TimerWheel wheel(loop->getRaw(), 5);
+  ASSERT_EQ(wheel.getTickMs(), 5);
+
+  // idle is reset on every "read" until the reads stop
+  TestEntry idle(0, fired, *loop);
+  TestEntry cancelled(1, fired, *loop);
+  auto destroyed = std::make_unique<TestEntry>(2, fired, *loop);
+  TestEntry reader(3, fired, *loop);
+
+  auto reads = 0;
+  reader.then = [&]() {
+    if (++reads < 10) {
+      wheel.schedule(&idle, 50);
+      wheel.schedule(&reader, 10);
+    }
+  };
+
+  auto start = uv_now(loop->getRaw());
+  wheel.schedule(&idle, 50);
+  wheel.schedule(&cancelled, 20);
+  wheel.schedule(destroyed.get(), 20);
+  wheel.schedule(&reader, 10);
+  wheel.cancel(&cancelled);
+  destroyed.reset();
+  ASSERT_FALSE(cancelled.isScheduled());
+  ASSERT_EQ(wheel.size(), 2);
+
+  loop->run();
+
+  ASSERT_EQ(reads, 10);
+  ASSERT_EQ(fired.back(), 0);
+  ASSERT_EQ(std::count(fired.begin(), fired.end(), 0), 1);
+  ASSERT_EQ(std::count(fired.begin(), fired.end(), 1), 0);
+  ASSERT_EQ(std::count(fired.begin(), fired.end(), 2), 0);
+  // the last reset came after 9 reads of at least 10 ms
+  ASSERT_GE(idle.firedAt - start, 90 + 50);
+}
+
+TEST(TimerWheel, CancelWhileFiring) {
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  std::vector<int> fired;
+  TimerWheel wheel(loop->getRaw());
+  TestEntry a(0, fired, *loop);
+  TestEntry b(1, fired, *loop);
+  TestEntry c(2, fired, *loop);
+  // all due in the same tick, whichever fires first cancels the others
+  a.then = b.then = c.then = [&]() {
+    wheel.cancel(&a);
+    wheel.cancel(&b);
+    wheel.cancel(&c);
+  };
+  wheel.schedule(&a, 5);
+  wheel.schedule(&b, 5);
+  wheel.schedule(&c, 5);
+
+  loop->run();
+
+  ASSERT_EQ(fired.size(), 1);
+  ASSERT_EQ(wheel.size(), 0);
+}
+
+TEST(TimerWheel, RescheduleFromTimeout) {
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  std::vector<int> fired;
+  TimerWheel wheel(loop->getRaw());
+  TestEntry entry{0, fired, *loop};
+  uint64_t firstAt = 0;
+  // due in the tick that is firing, it fires in the next one, not a full
+  // turn of the wheel later
+  entry.then = [&]{
+    if (fired.size() == 1) {
+      firstAt = entry.firedAt;
+      wheel.schedule(&entry, 0);
+    }
+  };
+  auto start = uv_now(loop->getRaw());
+  wheel.schedule(&entry, 20);
+
+  loop->run();
+
+  ASSERT_EQ(fired.size(), 2u);
+  ASSERT_GE(firstAt - start, 20u);
+  // a full turn is 64 ticks
+  ASSERT_LT(entry.firedAt - firstAt, 32u);
+}
@@ -166,3 +166,458 @@ TEST(Udp, RawSocket) {
   ASSERT_EQ(recvCount, EXPECTED_RECV_COUNT);
   ASSERT_EQ(destroyCount, EXPECTED_DESTROY_COUNT);
 }
+
+TEST(Udp, RecvBatch) {
+  const int COUNT = 20;
+  const std::size_t SLOT_SIZE = 64;
+
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  auto server = Udp<>::create(loop);
+  auto client = Udp<>::create(loop);
+  ASSERT_TRUE(!!server);
+  ASSERT_TRUE(!!client);
+
+  server->on<EvError>([](const auto &e, auto &udp) {
+    FAIL() << "server failed with status: " << e.status;
+  });
+
+  auto received = 0;
+  auto batches = 0;
+  server->on<EvRecvBatch>([&](const auto &e, auto &server) {
+    ++batches;
+    for (auto &entry : e) {
+      ASSERT_EQ(NetUtil::port(entry.addr), client->getPort());
+      if (received == COUNT - 1) {
+        // the last one is larger than a slot
+        ASSERT_TRUE(entry.truncated);
+        ASSERT_EQ(entry.len, SLOT_SIZE);
+      } else {
+        ASSERT_FALSE(entry.truncated);
+        ASSERT_EQ(std::string(entry.buf, entry.len),
+                  "msg-" + std::to_string(received));
+      }
+      ++received;
+    }
+    if (received == COUNT) {
+      server.close();
+      client->close();
+    }
+  });
+
+  ASSERT_TRUE(server->bind("127.0.0.1", 45680));
+  ASSERT_TRUE(client->bind("127.0.0.1", 0));
+  ASSERT_TRUE(server->recvBatchStart(8, SLOT_SIZE));
+
+  for (int i = 0; i < COUNT; ++i) {
+    auto msg = i == COUNT - 1 ?
+      std::string(SLOT_SIZE * 2, 'x') : "msg-" + std::to_string(i);
+    auto buf = std::make_unique<nul::Buffer>(msg.size());
+    buf->assign(msg.c_str(), msg.size());
+    ASSERT_TRUE(client->send(std::move(buf), server->getLocalSockAddr()));
+  }
+
+  loop->run();
+
+  ASSERT_EQ(received, COUNT);
+#ifdef __linux__
+  ASSERT_LT(batches, COUNT);
+#endif
+}
+
+TEST(Udp, SendBatch) {
+  // runs of equal sizes to one destination, a shorter tail, and datagrams
+  // interleaved between two destinations
+  const int COUNT = 100;
+  const std::size_t SIZE = 200;
+
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  auto server1 = Udp<>::create(loop);
+  auto server2 = Udp<>::create(loop);
+  auto client = Udp<>::create(loop);
+  ASSERT_TRUE(!!server1);
+  ASSERT_TRUE(!!server2);
+  ASSERT_TRUE(!!client);
+  ASSERT_TRUE(server1->bind("127.0.0.1", 45681));
+  ASSERT_TRUE(server2->bind("127.0.0.1", 45682));
+  ASSERT_TRUE(client->bind("127.0.0.1", 0));
+  client->setGso(true);
+
+  // everything is sent before the servers read
+  for (auto server : { server1, server2 }) {
+    uv_os_fd_t fd;
+    int rcvbuf = 1024 * 1024;
+    ASSERT_EQ(uv_fileno(reinterpret_cast<uv_handle_t *>(server->get()), &fd), 0);
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+  }
+
+  client->on<EvError>([](const auto &e, auto &udp) {
+    FAIL() << "client failed with status: " << e.status;
+  });
+
+  auto makeDatagram = [](int seq, std::size_t size) {
+    auto buf = std::make_unique<nul::Buffer>(size);
+    memset(buf->getData(), 'a' + seq % 26, size);
+    memcpy(buf->getData(), &seq, sizeof(seq));
+    buf->setLength(size);
+    return buf;
+  };
+
+  std::vector<int> received1;
+  std::vector<int> received2;
+  auto total = 0;
+  auto checkDatagram = [&](const RecvEntry &entry, std::vector<int> *received) {
+    int seq;
+    memcpy(&seq, entry.buf, sizeof(seq));
+    auto size = seq == COUNT - 1 ? SIZE / 2 : SIZE;
+    ASSERT_EQ(entry.len, size);
+    ASSERT_EQ(entry.buf[size - 1], 'a' + seq % 26);
+    received->push_back(seq);
+    if (++total == COUNT + 20) {
+      server1->close();
+      server2->close();
+      client->close();
+    }
+  };
+  server1->on<EvRecvBatch>([&](const auto &e, auto &server) {
+    for (auto &entry : e) {
+      checkDatagram(entry, &received1);
+    }
+  });
+  server2->on<EvRecvBatch>([&](const auto &e, auto &server) {
+    for (auto &entry : e) {
+      checkDatagram(entry, &received2);
+    }
+  });
+  ASSERT_TRUE(server1->recvBatchStart());
+  ASSERT_TRUE(server2->recvBatchStart());
+
+  std::size_t sent = 0;
+  auto sendCount = 0;
+  client->on<EvSendBatch>([&](const auto &e, auto &client) {
+    sent += e.sent;
+  });
+  client->on<EvSend>([&](const auto &e, auto &client) {
+    ++sendCount;
+  });
+
+  for (int i = 0; i < COUNT; ++i) {
+    client->sendBatch(makeDatagram(i, i == COUNT - 1 ? SIZE / 2 : SIZE),
+                      server1->getLocalSockAddr());
+  }
+  for (int i = 0; i < 20; ++i) {
+    client->sendBatch(makeDatagram(1000 + i, SIZE),
+                      (i % 2 ? server1 : server2)->getLocalSockAddr());
+  }
+
+  loop->run();
+
+  ASSERT_EQ(sent + sendCount, COUNT + 20);
+  ASSERT_EQ(received1.size(), COUNT + 10);
+  ASSERT_EQ(received2.size(), 10);
+  for (int i = 0; i < COUNT; ++i) {
+    ASSERT_EQ(received1[i], i);
+  }
+}
+
+TEST(Udp, Gro) {
+  const int COUNT = 40;
+  const std::size_t SIZE = 300;
+
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  auto server = Udp<>::create(loop);
+  auto client = Udp<>::create(loop);
+  ASSERT_TRUE(!!server);
+  ASSERT_TRUE(!!client);
+  ASSERT_TRUE(server->bind("127.0.0.1", 45683));
+  ASSERT_TRUE(client->bind("127.0.0.1", 0));
+  if (!server->setGro(true)) {
+    LOG_W("UDP_GRO is not supported, skipped");
+    return;
+  }
+  // a GSO run is received as one coalesced buffer
+  client->setGso(true);
+
+  std::vector<std::string> received;
+  server->on<EvRecvBatch>([&](const auto &e, auto &server) {
+    for (auto &entry : e) {
+      ASSERT_FALSE(entry.truncated);
+      received.emplace_back(entry.buf, entry.len);
+    }
+    if (received.size() == COUNT) {
+      server.close();
+      client->close();
+    }
+  });
+  ASSERT_TRUE(server->recvBatchStart(4));
+
+  std::vector<std::string> sent;
+  for (int i = 0; i < COUNT; ++i) {
+    auto size = i == COUNT - 1 ? SIZE / 3 : SIZE;
+    sent.emplace_back(size, 'a' + i % 26);
+    auto buf = std::make_unique<nul::Buffer>(size);
+    buf->assign(sent.back().data(), size);
+    client->sendBatch(std::move(buf), server->getLocalSockAddr());
+  }
+
+  loop->run();
+
+  ASSERT_EQ(received, sent);
+}
+
+TEST(Udp, Connected) {
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  auto server = Udp<>::create(loop);
+  auto client = Udp<>::create(loop);
+  auto other = Udp<>::create(loop);
+  ASSERT_TRUE(!!server);
+  ASSERT_TRUE(!!client);
+  ASSERT_TRUE(!!other);
+  ASSERT_TRUE(server->bind("127.0.0.1", 45684));
+  ASSERT_TRUE(other->bind("127.0.0.1", 0));
+  ASSERT_TRUE(client->connect("127.0.0.1", 45684));
+  ASSERT_TRUE(client->isConnected());
+
+  client->on<EvError>([](const auto &e, auto &udp) {
+    FAIL() << "client failed with status: " << e.status;
+  });
+
+  // the server echoes, and also sends to the client from another socket,
+  // which the connected client must not receive
+  std::vector<std::string> received;
+  server->on<EvRecv>([&](const auto &e, auto &server) {
+    ASSERT_EQ(NetUtil::port(e.addr), client->getPort());
+    auto buf = std::make_unique<nul::Buffer>(e.nread);
+    buf->assign(e.buf, e.nread);
+    server.send(std::move(buf), e.addr);
+
+    auto stray = std::make_unique<nul::Buffer>(5);
+    stray->assign("stray", 5);
+    other->send(std::move(stray), e.addr);
+  });
+  client->on<EvRecv>([&](const auto &e, auto &client) {
+    received.emplace_back(e.buf, e.nread);
+    if (received.size() == 3) {
+      client.close();
+      server->close();
+      other->close();
+    }
+  });
+  server->recvStart();
+  client->recvStart();
+
+  auto makeBuffer = [](const std::string &msg) {
+    auto buf = std::make_unique<nul::Buffer>(msg.size());
+    buf->assign(msg.c_str(), msg.size());
+    return buf;
+  };
+  ASSERT_TRUE(client->send(makeBuffer("one")));
+  ASSERT_TRUE(client->send(makeBuffer("two")));
+  client->sendBatch(makeBuffer("three"));
+
+  loop->run();
+
+  ASSERT_EQ(received, (std::vector<std::string>{ "one", "two", "three" }));
+}
+
+TEST(Udp, DestinationAddr) {
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  auto server = Udp<>::create(loop);
+  auto client = Udp<>::create(loop);
+  ASSERT_TRUE(!!server);
+  ASSERT_TRUE(!!client);
+  ASSERT_TRUE(server->bind("127.0.0.1", 45685));
+
+  std::string received;
+  server->on<EvRecv>([&](const auto &e, auto &server) {
+    received.assign(e.buf, e.nread);
+    server.close();
+    client->close();
+  });
+  server->recvStart();
+
+  client->setDesitinationAddr("127.0.0.1", 45685);
+  auto buf = std::make_unique<nul::Buffer>(5);
+  buf->assign("hello", 5);
+  ASSERT_TRUE(client->send(std::move(buf)));
+
+  loop->run();
+
+  ASSERT_EQ(received, "hello");
+}
+
+TEST(Udp, TrySend) {
+  const int COUNT = 20;
+
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  auto server = Udp<>::create(loop);
+  auto client = Udp<>::create(loop);
+  ASSERT_TRUE(!!server);
+  ASSERT_TRUE(!!client);
+  ASSERT_TRUE(server->bind("127.0.0.1", 45686));
+  ASSERT_TRUE(client->connect(server->getLocalSockAddr()));
+
+  client->on<EvError>([](const auto &e, auto &udp) {
+    FAIL() << "client failed with status: " << e.status;
+  });
+
+  // the buffer is handed back right away, and reused for every datagram
+  std::unique_ptr<nul::Buffer> recycled;
+  auto sendCount = 0;
+  client->on<EvBufferRecycled>([&](const auto &e, auto &client) {
+    recycled = std::move(e.buffer);
+  });
+  client->on<EvSend>([&](const auto &e, auto &client) {
+    ++sendCount;
+  });
+
+  std::vector<int> received;
+  server->on<EvRecv>([&](const auto &e, auto &server) {
+    int seq;
+    ASSERT_EQ(e.nread, sizeof(seq));
+    memcpy(&seq, e.buf, sizeof(seq));
+    received.push_back(seq);
+    if (received.size() == COUNT) {
+      server.close();
+      client->close();
+    }
+  });
+  server->recvStart();
+
+  recycled = std::make_unique<nul::Buffer>(sizeof(int));
+  auto first = recycled.get();
+  for (int i = 0; i < COUNT; ++i) {
+    ASSERT_TRUE(!!recycled);
+    recycled->assign(reinterpret_cast<const char *>(&i), sizeof(i));
+    ASSERT_TRUE(client->trySend(std::move(recycled)));
+    ASSERT_EQ(sendCount, i + 1);
+  }
+  ASSERT_EQ(recycled.get(), first);
+
+  loop->run();
+
+  ASSERT_EQ(received.size(), COUNT);
+  for (int i = 0; i < COUNT; ++i) {
+    ASSERT_EQ(received[i], i);
+  }
+}
+
+TEST(Udp, OwnedRecvBuffers) {
+  const int COUNT = 10;
+
+  // no 32 KB inline buffer on handles that receive into owned buffers
+  ASSERT_GE(sizeof(Udp<>) - sizeof(Udp<0>), 32768 - sizeof(void *));
+
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  auto server = Udp<0>::create(loop);
+  auto client = Udp<>::create(loop);
+  ASSERT_TRUE(!!server);
+  ASSERT_TRUE(!!client);
+  ASSERT_TRUE(server->bind("127.0.0.1", 45687));
+  ASSERT_TRUE(client->connect(server->getLocalSockAddr()));
+
+  server->on<EvError>([](const auto &e, auto &udp) {
+    FAIL() << "server failed with status: " << e.status;
+  });
+
+  // the first and the last datagrams are kept, the ones in between are
+  // received into the same buffer
+  std::vector<std::unique_ptr<nul::Buffer>> kept;
+  std::vector<const char *> reused;
+  auto count = 0;
+  server->on<EvRecv>([&](const auto &e, auto &server) {
+    ASSERT_TRUE(!!e.buffer);
+    ASSERT_EQ(e.buf, e.buffer->getData());
+    ASSERT_EQ(e.buffer->getLength(), e.nread);
+    ASSERT_EQ(e.buffer->getCapacity(), 2048);
+    ++count;
+    if (count == 1 || count == COUNT) {
+      kept.push_back(std::move(e.buffer));
+    } else {
+      reused.push_back(e.buf);
+    }
+    if (count == COUNT) {
+      server.close();
+      client->close();
+    }
+  });
+  server->setOwnedRecvBuffers(1500);
+  server->recvStart();
+
+  for (int i = 0; i < COUNT; ++i) {
+    auto buf = std::make_unique<nul::Buffer>(1400);
+    memset(buf->getData(), 'a' + i, 1400);
+    buf->setLength(1400);
+    ASSERT_TRUE(client->send(std::move(buf)));
+  }
+
+  loop->run();
+
+  ASSERT_EQ(kept.size(), 2);
+  ASSERT_NE(kept[0].get(), kept[1].get());
+  ASSERT_EQ(kept[0]->getLength(), 1400);
+  ASSERT_EQ(kept[0]->getData()[0], 'a');
+  ASSERT_EQ(kept[0]->getData()[1399], 'a');
+  ASSERT_EQ(kept[1]->getData()[0], 'a' + COUNT - 1);
+  ASSERT_EQ(reused.size(), COUNT - 2);
+  for (auto p : reused) {
+    ASSERT_EQ(p, kept[1]->getData());
+  }
+}
+
+TEST(Udp, OwnedRecvBufferNotPublishedAsRecycled) {
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  auto server = Udp<0>::create(loop);
+  auto client = Udp<>::create(loop);
+  ASSERT_TRUE(!!server);
+  ASSERT_TRUE(!!client);
+  ASSERT_TRUE(server->bind("127.0.0.1", 45688));
+  ASSERT_TRUE(client->connect(server->getLocalSockAddr()));
+
+  // the receive buffers replaced by setOwnedRecvBuffers, and the one left
+  // on close go back to the pool, they were never handed in by the user
+  auto recycled = 0;
+  server->on<EvBufferRecycled>([&](const auto &e, auto &server) {
+    ++recycled;
+  });
+  auto count = 0;
+  server->on<EvRecv>([&](const auto &e, auto &server) {
+    if (++count == 1) {
+      ASSERT_EQ(e.buffer->getCapacity(), 2048);
+      server.setOwnedRecvBuffers(4000);
+    } else {
+      ASSERT_EQ(e.buffer->getCapacity(), 4096);
+      server.close();
+      client->close();
+    }
+  });
+  server->setOwnedRecvBuffers(1500);
+  server->recvStart();
+
+  for (int i = 0; i < 2; ++i) {
+    auto buf = std::make_unique<nul::Buffer>(100);
+    buf->setLength(100);
+    ASSERT_TRUE(client->send(std::move(buf)));
+  }
+
+  loop->run();
+
+  ASSERT_EQ(count, 2);
+  ASSERT_EQ(recycled, 0);
+  ASSERT_EQ(loop->getBufferPool().getStats().inUse, 0);
+}
@@ -0,0 +1,280 @@
+#include <gtest/gtest.h>
+#include "uvcpp.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using namespace uvcpp;
+
+TEST(WorkExecutor, Submit) {
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  WorkExecutor executor{loop, 2};
+  ASSERT_TRUE(executor.start());
+  ASSERT_EQ(executor.getThreadCount(), 2u);
+
+  auto loopThread = std::this_thread::get_id();
+  auto results = 0;
+  auto jobThread = loopThread;
+
+  ASSERT_TRUE(executor.submit([&jobThread]{
+    jobThread = std::this_thread::get_id();
+    return std::string{"done"};
+  }, [&](WorkResult<std::string> &r) {
+    ASSERT_EQ(std::this_thread::get_id(), loopThread);
+    ASSERT_TRUE(r.ok());
+    ASSERT_EQ(r.get(), "done");
+    ++results;
+  }));
+
+  ASSERT_TRUE(executor.submit([]() -> int {
+    throw std::runtime_error("failed");
+  }, [&](WorkResult<int> &r) {
+    ASSERT_FALSE(r.ok());
+    ASSERT_EQ(r.status(), 0);
+    ASSERT_THROW(r.get(), std::runtime_error);
+    ++results;
+  }));
+
+  auto ran = false;
+  ASSERT_TRUE(executor.submit([&ran]{ ran = true; },
+                              [&](WorkResult<void> &r) {
+    ASSERT_TRUE(r.ok());
+    // jobs may be submitted from completions
+    executor.submit([]{ return 1; }, [&](WorkResult<int> &r) {
+      ASSERT_EQ(r.get(), 1);
+      ++results;
+    });
+    ++results;
+  }));
+  ASSERT_EQ(executor.getInFlight(), 3u);
+
+  // returns once all the jobs completed
+  loop->run();
+
+  ASSERT_EQ(results, 4);
+  ASSERT_TRUE(ran);
+  ASSERT_NE(jobThread, loopThread);
+  ASSERT_EQ(executor.getInFlight(), 0u);
+
+  // lets the Async of the executor close
+  executor.shutdown();
+  loop->run();
+}
+
+TEST(WorkExecutor, Batch) {
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  WorkExecutor executor{loop, 4};
+  ASSERT_TRUE(executor.start());
+
+  const std::size_t JOBS = 1000;
+  std::vector<std::function<long()>> jobs;
+  for (std::size_t i = 0; i < JOBS; ++i) {
+    jobs.push_back([i]{ return static_cast<long>(i * i); });
+  }
+
+  auto completions = 0;
+  ASSERT_TRUE(executor.submitBatch(std::move(jobs), [&](auto &results) {
+    ++completions;
+    ASSERT_EQ(results.size(), JOBS);
+    for (std::size_t i = 0; i < JOBS; ++i) {
+      ASSERT_EQ(results[i].get(), static_cast<long>(i * i));
+    }
+  }));
+  ASSERT_EQ(executor.getInFlight(), 1u);
+
+  ASSERT_TRUE(executor.submitBatch(std::vector<std::function<void()>>{},
+                                   [&](auto &results) {
+    ASSERT_TRUE(results.empty());
+    ++completions;
+  }));
+
+  loop->run();
+
+  ASSERT_EQ(completions, 2);
+
+  executor.shutdown();
+  loop->run();
+}
+
+TEST(WorkExecutor, DoesNotStarveThreadpool) {
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  WorkExecutor executor{loop, 1};
+  ASSERT_TRUE(executor.start());
+
+  // keeps the only executor thread busy until the threadpool work is done
+  std::atomic<bool> release{false};
+  auto blockedDone = false;
+  executor.submit([&release]{
+    while (!release) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }, [&](WorkResult<void> &r) {
+    blockedDone = true;
+  });
+
+  auto work = Work::create(loop);
+  ASSERT_TRUE(!!work);
+  auto workDone = false;
+  work->on<EvAfterWork>([&](const auto &e, auto &work) {
+    ASSERT_FALSE(blockedDone);
+    workDone = true;
+    release = true;
+  });
+  work->start();
+
+  loop->run();
+
+  ASSERT_TRUE(workDone);
+  ASSERT_TRUE(blockedDone);
+
+  executor.shutdown();
+  loop->run();
+}
+
+TEST(WorkExecutor, ShutdownCancelsQueuedJobs) {
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  WorkExecutor executor{loop, 1};
+  ASSERT_TRUE(executor.start());
+
+  std::atomic<bool> started{false};
+  auto completed = 0;
+  auto cancelled = 0;
+  auto count = [&](WorkResult<int> &r) {
+    if (r.status() == UV_ECANCELED) {
+      ++cancelled;
+    } else {
+      ASSERT_EQ(r.get(), 1);
+      ++completed;
+    }
+  };
+
+  executor.submit([&started]{
+    started = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    return 1;
+  }, count);
+  for (auto i = 0; i < 5; ++i) {
+    executor.submit([]{ return 1; }, count);
+  }
+  std::vector<std::function<int()>> jobs(10, []{ return 1; });
+  auto batchCancelled = 0;
+  executor.submitBatch(std::move(jobs), [&](auto &results) {
+    for (auto &r : results) {
+      batchCancelled += r.status() == UV_ECANCELED;
+    }
+  });
+
+  while (!started) {
+    std::this_thread::yield();
+  }
+  executor.shutdown();
+
+  // all completed synchronously, the running job included
+  ASSERT_EQ(completed, 1);
+  ASSERT_EQ(cancelled, 5);
+  ASSERT_EQ(batchCancelled, 10);
+  ASSERT_EQ(executor.getInFlight(), 0u);
+  ASSERT_FALSE(executor.submit([]{ return 1; }, count));
+
+  loop->run();
+}
+
+TEST(WorkExecutor, ParallelFor) {
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  WorkExecutor executor{loop, 4};
+  ASSERT_TRUE(executor.start());
+
+  const std::size_t COUNT = 100000;
+  std::vector<int> hits(COUNT);
+  auto completions = 0;
+
+  ASSERT_TRUE(executor.parallelFor(0, COUNT, 0, [&hits](std::size_t i) {
+    ++hits[i];
+  }, [&](WorkResult<void> &r) {
+    ASSERT_TRUE(r.ok());
+    ++completions;
+  }));
+
+  std::atomic<std::size_t> sum{0};
+  ASSERT_TRUE(executor.parallelFor(10, 1010, 7, [&sum](std::size_t i) {
+    sum += i;
+  }, [&](WorkResult<void> &r) {
+    ASSERT_TRUE(r.ok());
+    ASSERT_EQ(sum, (10 + 1009) * 1000u / 2);
+    ++completions;
+  }));
+
+  ASSERT_TRUE(executor.parallelFor(0, 1000, 1, [](std::size_t i) {
+    if (i == 500) {
+      throw std::runtime_error("failed");
+    }
+  }, [&](WorkResult<void> &r) {
+    ASSERT_FALSE(r.ok());
+    ASSERT_THROW(r.get(), std::runtime_error);
+    ++completions;
+  }));
+
+  ASSERT_TRUE(executor.parallelFor(5, 5, 0, [](std::size_t i) {
+    FAIL() << "empty range";
+  }, [&](WorkResult<void> &r) {
+    ASSERT_TRUE(r.ok());
+    ++completions;
+  }));
+
+  loop->run();
+
+  ASSERT_EQ(completions, 4);
+  ASSERT_EQ(std::count(hits.begin(), hits.end(), 1),
+            static_cast<long>(COUNT));
+
+  executor.shutdown();
+  loop->run();
+}
+
+TEST(WorkExecutor, IdleThreadsSteal) {
+  auto loop = std::make_shared<Loop>();
+  ASSERT_TRUE(loop->init());
+
+  WorkExecutor executor{loop, 4};
+  ASSERT_TRUE(executor.start());
+
+  // occupies the thread the first job is queued on, the jobs queued on
+  // that thread behind it only run if the other threads steal them
+  std::atomic<bool> release{false};
+  executor.submit([&release]{
+    while (!release) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }, [](WorkResult<void> &r) { });
+
+  const auto JOBS = 40;
+  auto completed = 0;
+  for (auto i = 0; i < JOBS; ++i) {
+    executor.submit([]{ return 1; }, [&](WorkResult<int> &r) {
+      if (++completed == JOBS) {
+        release = true;
+      }
+    });
+  }
+
+  loop->run();
+
+  ASSERT_EQ(completed, JOBS);
+
+  executor.shutdown();
+  loop->run();
+}